@@ -1,17 +1,80 @@
 /*
  * Program to parse a float into its sign, exponent, and mantissa, in both decimal and binary.
+ * Run with -d float_file to decompose a whole file of raw 32 bit floats instead, writing the
+ * signs, exponents, and mantissas to output_prefix.sign, output_prefix.exponent, and
+ * output_prefix.mantissa as separate arrays, or summarizing them if no prefix is given.
+ * Run with -h float_file, or -h all for every possible float, to classify the floats and count
+ * their exponents and mantissa bits across threads threads, one per processor by default.
+ * Run with -p float_file to print the same report as the prompt for every float in a file.
+ * Compile with: gcc -O2 float_fields.c -lpthread
  * Author: Neo Zhou - zhouaea@bc.edu
  */
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
-#define TRUE 1
-#define FALSE 0
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+// Room for the whole report on one float, binary representation included.
+#define MAX_REPORT_SIZE 512
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+// Floats are decomposed this many at a time, so the field arrays of a chunk stay in cache.
+#define CHUNK_FLOATS (1 << 16)
 
 typedef union converter {
     float f;
     unsigned int u;
 } converter;
 
+char binary_digits[256][8];
+
+/*
+ * Counts of the fields of a set of floats. zero_mantissas counts, for each exponent, the floats
+ * with a mantissa of 0, which tells zeroes from denormals and infinities from NaNs.
+ * mantissa_bytes counts the values of each byte of the mantissa, from which the number of floats
+ * with each mantissa bit set follows without testing all 23 bits of every float.
+ * significant_bits counts floats by how many mantissa bits are left after trailing zeroes.
+ */
+typedef struct float_histogram {
+    unsigned long negatives;
+    unsigned long exponents[256];
+    unsigned long zero_mantissas[256];
+    unsigned long mantissa_bytes[3][256];
+    unsigned long significant_bits[24];
+} float_histogram;
+
+/*
+ * The floats one thread counts: values[start] up to values[end], or if values is NULL, every
+ * float whose bits are from start up to end.
+ */
+typedef struct histogram_parameters {
+    const unsigned int * values;
+    uint64_t start;
+    uint64_t end;
+    float_histogram histogram;
+} histogram_parameters;
+
+/*
+ * A file of floats mapped into memory. bytes is the length of the mapping, which may end in a
+ * few bytes too short to be a float.
+ */
+typedef struct mapped_floats {
+    const unsigned int * values;
+    size_t count;
+    size_t bytes;
+} mapped_floats;
+
 /*
  * Extract the sign from a 32 bit float.
  */
@@ -58,145 +121,577 @@ void parse_input(unsigned int input, unsigned int *sign_ptr, unsigned int *expon
 }
 
 /*
- * Print the floating point input (interpreted as an unsigned integer) in binary
- * without removing leading or trailing zeroes.
+ * Decompose count floats with parse_input, one at a time.
  */
-void print_input_binary(unsigned int decimal) {
-    int reverse_bits[32];
-    
-    // Initialize reverse bits array to all 0's.
-    for (int i = 0; i < 32; i++) {
-        reverse_bits[i] = 0;
+void decompose_floats_scalar(const unsigned int * input, size_t count, unsigned char * signs,
+                             unsigned char * exponents, unsigned int * mantissas) {
+    for (size_t i = 0; i < count; i++) {
+        unsigned int sign;
+        unsigned int exponent;
+        parse_input(input[i], &sign, &exponent, &mantissas[i]);
+        signs[i] = sign;
+        exponents[i] = exponent;
     }
-    
-    int i = 0;
-    
-    // Get the remainder of dividing the decimal by 2 in order to get reverse binary digits.
-    while (decimal > 0) {
-        reverse_bits[i] = decimal % 2;
-        decimal /= 2;
-        i++;
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * Decompose floats with AVX2, 32 at a time. The fields come out of the same shifts and masks as
+ * parse_input, applied to eight floats per instruction. The signs and exponents are then packed
+ * down from 32 bits to 8: the packs work within each 128 bit half of the registers, so a final
+ * permute puts the bytes back in order.
+ */
+__attribute__((target("avx2")))
+void decompose_floats_avx2(const unsigned int * input, size_t count, unsigned char * signs,
+                           unsigned char * exponents, unsigned int * mantissas) {
+    const __m256i exponent_mask = _mm256_set1_epi32(0xff);
+    const __m256i mantissa_mask = _mm256_set1_epi32(0x7fffff);
+    const __m256i byte_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i sign_words[4];
+        __m256i exponent_words[4];
+        for (int v = 0; v < 4; v++) {
+            __m256i bits = _mm256_loadu_si256((const __m256i *) (input + i + 8 * v));
+            sign_words[v] = _mm256_srli_epi32(bits, 31);
+            exponent_words[v] = _mm256_and_si256(_mm256_srli_epi32(bits, 23), exponent_mask);
+            _mm256_storeu_si256((__m256i *) (mantissas + i + 8 * v),
+                                _mm256_and_si256(bits, mantissa_mask));
+        }
+        __m256i sign_bytes = _mm256_packus_epi16(
+            _mm256_packus_epi32(sign_words[0], sign_words[1]),
+            _mm256_packus_epi32(sign_words[2], sign_words[3]));
+        __m256i exponent_bytes = _mm256_packus_epi16(
+            _mm256_packus_epi32(exponent_words[0], exponent_words[1]),
+            _mm256_packus_epi32(exponent_words[2], exponent_words[3]));
+        _mm256_storeu_si256((__m256i *) (signs + i),
+                            _mm256_permutevar8x32_epi32(sign_bytes, byte_order));
+        _mm256_storeu_si256((__m256i *) (exponents + i),
+                            _mm256_permutevar8x32_epi32(exponent_bytes, byte_order));
     }
-    
-    // Print the reverse binary digits in reverse to get the binary representation of the decimal.
-    printf("\nBinary Representation:\n");
-    
-    
-    for (int i = 31; i >= 0; i--) {
-        printf("%d", reverse_bits[i]);
+    // Finish the floats that do not fill a whole step one at a time.
+    decompose_floats_scalar(input + i, count - i, signs + i, exponents + i, mantissas + i);
+}
+
+/*
+ * Decompose floats with AVX-512, 16 at a time, which can narrow 32 bit fields to bytes in order
+ * with a single instruction.
+ */
+__attribute__((target("avx512f")))
+void decompose_floats_avx512(const unsigned int * input, size_t count, unsigned char * signs,
+                             unsigned char * exponents, unsigned int * mantissas) {
+    const __m512i exponent_mask = _mm512_set1_epi32(0xff);
+    const __m512i mantissa_mask = _mm512_set1_epi32(0x7fffff);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i bits = _mm512_loadu_si512((const void *) (input + i));
+        _mm_storeu_si128((__m128i *) (signs + i),
+                         _mm512_cvtepi32_epi8(_mm512_srli_epi32(bits, 31)));
+        _mm_storeu_si128((__m128i *) (exponents + i),
+                         _mm512_cvtepi32_epi8(_mm512_and_si512(_mm512_srli_epi32(bits, 23),
+                                                               exponent_mask)));
+        _mm512_storeu_si512((void *) (mantissas + i), _mm512_and_si512(bits, mantissa_mask));
     }
-    printf("\n\n");
+    decompose_floats_scalar(input + i, count - i, signs + i, exponents + i, mantissas + i);
 }
+#endif
 
 /*
- * Print an unsigned decimal integer in binary, removing the leading zeroes;
- * this will be used to print the exponent in binary.
+ * Decompose count floats into separate arrays of signs, exponents, and mantissas, using the
+ * widest vector instructions the processor has.
  */
-void print_binary(unsigned int decimal) {
-    int reverse_bits[32];
-    
-    // Initialize reverse bits array to all 0's.
-    for (int i = 0; i < 32; i++) {
-        reverse_bits[i] = 0;
+void decompose_floats(const unsigned int * input, size_t count, unsigned char * signs,
+                      unsigned char * exponents, unsigned int * mantissas) {
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx512f")) {
+        decompose_floats_avx512(input, count, signs, exponents, mantissas);
+        return;
     }
-    
-    int i = 0;
-    
-    // Get the remainder of dividing the decimal by 2 in order to get reverse binary digits.
-    while (decimal > 0) {
-        reverse_bits[i] = decimal % 2;
-        decimal /= 2;
-        i++;
+    if (__builtin_cpu_supports("avx2")) {
+        decompose_floats_avx2(input, count, signs, exponents, mantissas);
+        return;
     }
-    
-    // Print the reverse binary digits in reverse to get the binary representation of the decimal.
-    printf("\t\tbinary: ");
-    
-    int leading_zeroes = TRUE;
-    
-    for (int i = 31; i >= 0; i--) {
-        // If there are no more uneccesary leading zeroes, print the binary digit.
-        if (!leading_zeroes) {
-            printf("%d", reverse_bits[i]);
+#endif
+    decompose_floats_scalar(input, count, signs, exponents, mantissas);
+}
+
+/*
+ * Map a file of raw floats into memory for reading straight through. Returns 0 on success and -1
+ * if the file can not be opened or mapped.
+ */
+int map_floats(const char * path, mapped_floats * floats) {
+    int fd = open(path, O_RDONLY);
+    struct stat file_stat;
+    if (fd == -1 || fstat(fd, &file_stat) == -1) {
+        printf("File could not be opened\n");
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    floats->bytes = file_stat.st_size;
+    floats->count = floats->bytes / sizeof(unsigned int);
+    floats->values = NULL;
+    if (floats->bytes > 0) {
+        void * mapping = mmap(NULL, floats->bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            printf("File could not be mapped\n");
+            close(fd);
+            return -1;
+        }
+        madvise(mapping, floats->bytes, MADV_SEQUENTIAL);
+        floats->values = (const unsigned int *) mapping;
+    }
+    close(fd);
+    return 0;
+}
+
+/*
+ * Unmap a file mapped by map_floats.
+ */
+void unmap_floats(mapped_floats * floats) {
+    if (floats->values) {
+        munmap((void *) floats->values, floats->bytes);
+    }
+}
+
+/*
+ * Obtain the current time in seconds.
+ */
+double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/*
+ * Open output_prefix.suffix for writing.
+ */
+FILE * open_field_file(const char * output_prefix, const char * suffix) {
+    size_t length = strlen(output_prefix) + strlen(suffix) + 2;
+    char * path = (char *) malloc(length);
+    snprintf(path, length, "%s.%s", output_prefix, suffix);
+    FILE * fptr = fopen(path, "wb");
+    free(path);
+    return fptr;
+}
+
+/*
+ * Decompose every float in a file a chunk at a time. With an output prefix, each chunk's fields
+ * are appended to the three field files; otherwise they are summarized. Reports the rate the
+ * file was read at. Returns 0 on success and -1 on failure.
+ */
+int decompose_file(const char * path, const char * output_prefix) {
+    mapped_floats floats;
+    if (map_floats(path, &floats) != 0) {
+        return -1;
+    }
+    FILE * field_files[3] = {NULL, NULL, NULL};
+    if (output_prefix) {
+        field_files[0] = open_field_file(output_prefix, "sign");
+        field_files[1] = open_field_file(output_prefix, "exponent");
+        field_files[2] = open_field_file(output_prefix, "mantissa");
+        if (!field_files[0] || !field_files[1] || !field_files[2]) {
+            printf("File could not be opened\n");
+            for (int f = 0; f < 3; f++) {
+                if (field_files[f]) {
+                    fclose(field_files[f]);
+                }
+            }
+            unmap_floats(&floats);
+            return -1;
+        }
+    }
+
+    unsigned char * signs = (unsigned char *) malloc(CHUNK_FLOATS);
+    unsigned char * exponents = (unsigned char *) malloc(CHUNK_FLOATS);
+    unsigned int * mantissas = (unsigned int *) malloc(CHUNK_FLOATS * sizeof(unsigned int));
+    size_t negatives = 0;
+    size_t exponent_total = 0;
+    unsigned int mantissa_bits = 0;
+    int status = 0;
+    double start = now();
+    for (size_t chunk = 0; chunk < floats.count; chunk += CHUNK_FLOATS) {
+        size_t count = floats.count - chunk < CHUNK_FLOATS ? floats.count - chunk : CHUNK_FLOATS;
+        decompose_floats(floats.values + chunk, count, signs, exponents, mantissas);
+        if (output_prefix) {
+            if (fwrite(signs, 1, count, field_files[0]) != count ||
+                fwrite(exponents, 1, count, field_files[1]) != count ||
+                fwrite(mantissas, sizeof(unsigned int), count, field_files[2]) != count) {
+                status = -1;
+                break;
+            }
             continue;
         }
-        
-        // Once the rightmost one is reached, we know there can no longer be any leading zeroes
-        if (reverse_bits[i] == 1) {
-            leading_zeroes = FALSE;
-            printf("%d", reverse_bits[i]);
+        // Sums over one chunk fit in 32 bits, which lets these loops vectorize.
+        unsigned int chunk_negatives = 0;
+        unsigned int chunk_exponent_total = 0;
+        for (size_t i = 0; i < count; i++) {
+            chunk_negatives += signs[i];
+            chunk_exponent_total += exponents[i];
+            mantissa_bits |= mantissas[i];
+        }
+        negatives += chunk_negatives;
+        exponent_total += chunk_exponent_total;
+    }
+    double seconds = now() - start;
+    for (int f = 0; f < 3; f++) {
+        if (field_files[f] && fclose(field_files[f]) != 0) {
+            status = -1;
+        }
+    }
+
+    if (status != 0) {
+        printf("File could not be written\n");
+    } else {
+        if (!output_prefix) {
+            printf("negative: %zu\n", negatives);
+            printf("mean exponent without bias: %lf\n",
+                   floats.count ? (double) exponent_total / floats.count - 127 : 0.0);
+            printf("mantissa bits ever set: 0x%06x\n", mantissa_bits);
         }
+        printf("Decomposed %zu floats (%.3lf GB) in %lf seconds, %.2lf GB/s\n", floats.count,
+               floats.count * sizeof(float) / 1e9, seconds,
+               seconds > 0 ? floats.count * sizeof(float) / 1e9 / seconds : 0.0);
     }
-    printf("\n");
+    free(signs);
+    free(exponents);
+    free(mantissas);
+    unmap_floats(&floats);
+    return status;
 }
 
 /*
- * Print numbers in binary and decimal that add a leading '1.' to a decimal input;
- * this will be used to print the mantissa in binary and decimal while restoring the leading '1.'.
- * When it prints the binary number, it removes trailing zeroes.
+ * Count the fields of one float into a histogram.
  */
-void print_binary_and_decimal_with_leading_one(unsigned int decimal) {
-    int reverse_bits[23];
-    
-    // Initialize reverse bits array to all 0's.
-    for (int i = 0; i < 23; i++) {
-        reverse_bits[i] = 0;
+static inline void count_float(float_histogram * histogram, unsigned int input) {
+    unsigned int sign;
+    unsigned int exponent;
+    unsigned int mantissa;
+    parse_input(input, &sign, &exponent, &mantissa);
+    histogram->negatives += sign;
+    ++histogram->exponents[exponent];
+    histogram->zero_mantissas[exponent] += mantissa == 0;
+    ++histogram->mantissa_bytes[0][mantissa & 0xff];
+    ++histogram->mantissa_bytes[1][(mantissa >> 8) & 0xff];
+    ++histogram->mantissa_bytes[2][mantissa >> 16];
+    // Setting bit 23 makes a mantissa of 0 count as having no significant bits.
+    ++histogram->significant_bits[23 - __builtin_ctz(mantissa | (1 << 23))];
+}
+
+/*
+ * Count one thread's share of the floats into its own histogram, so threads never write to the
+ * same counters.
+ */
+void * histogram_worker(void * arguments) {
+    histogram_parameters * parameters = (histogram_parameters *) arguments;
+    float_histogram * histogram = &parameters->histogram;
+    if (parameters->values) {
+        for (uint64_t i = parameters->start; i < parameters->end; i++) {
+            count_float(histogram, parameters->values[i]);
+        }
+    } else {
+        for (uint64_t i = parameters->start; i < parameters->end; i++) {
+            count_float(histogram, (unsigned int) i);
+        }
     }
-    
-    int i = 0;
-    
-    // Get the remainder of dividing the decimal by 2 in order to get reverse binary digits.
-    while (decimal > 0) {
-        reverse_bits[i] = decimal % 2;
-        decimal /= 2;
-        i++;
+    return NULL;
+}
+
+/*
+ * Print a count along with its share of total.
+ */
+void print_count(const char * label, unsigned long count, uint64_t total) {
+    printf("\t\t%s: %lu (%.4lf%%)\n", label, count, total ? 100.0 * count / total : 0.0);
+}
+
+/*
+ * Print the classes, exponents, and mantissa bit usage counted in a histogram of total floats.
+ */
+void print_histogram(float_histogram * histogram, uint64_t total) {
+    unsigned long zeroes = histogram->zero_mantissas[0];
+    unsigned long infinities = histogram->zero_mantissas[255];
+    printf("Classes:\n");
+    print_count("zero", zeroes, total);
+    print_count("denormal", histogram->exponents[0] - zeroes, total);
+    print_count("normal", total - histogram->exponents[0] - histogram->exponents[255], total);
+    print_count("infinity", infinities, total);
+    print_count("NaN", histogram->exponents[255] - infinities, total);
+    print_count("negative", histogram->negatives, total);
+
+    printf("Exponent without bias (normal floats):\n");
+    for (int exponent = 1; exponent < 255; exponent++) {
+        if (histogram->exponents[exponent]) {
+            char label[16];
+            snprintf(label, sizeof(label), "%d", exponent - 127);
+            print_count(label, histogram->exponents[exponent], total);
+        }
     }
-    
-    // Mark the trailing zeroes as threes.
-    for (int i = 0; i < 23; i++) {
-        // Mark any zeroes at the end of the floating point as a three, until a 1 is found.
-        if (reverse_bits[i] == 0) {
-            reverse_bits[i] = 3;
-        } else {
-            break;
+
+    printf("Mantissa bits set:\n");
+    for (int bit = 22; bit >= 0; bit--) {
+        unsigned long count = 0;
+        for (int value = 0; value < 256; value++) {
+            if (value & (1 << (bit % 8))) {
+                count += histogram->mantissa_bytes[bit / 8][value];
+            }
         }
+        char label[16];
+        snprintf(label, sizeof(label), "bit %d", bit);
+        print_count(label, count, total);
     }
-    
-    // Print the reverse binary digits in reverse to get the binary representation of the decimal.
-    printf("\t\tbinary (with added one): 1.");
-    for (int i = 22; i >= 0; i--) {
-        // Print the binary digit if it is not a trailing zero.
-        if (reverse_bits[i] != 3) {
-            printf("%d", reverse_bits[i]);
+
+    printf("Significant mantissa bits:\n");
+    for (int bits = 0; bits <= 23; bits++) {
+        if (histogram->significant_bits[bits]) {
+            char label[16];
+            snprintf(label, sizeof(label), "%d", bits);
+            print_count(label, histogram->significant_bits[bits], total);
         }
     }
-    printf("\n");
-    
-    // Print the decimal representation of adding a 1. to the binary of the decimal input.
-    float decimal_with_leading_one = 1;
-    float power_of_2 = 0.5;
-    for (int i = 22; i >= 0; i--) {
-        // Do not calculate a bit if it is a trailing 0.
-        if (reverse_bits[i] != 3) {
-            decimal_with_leading_one += power_of_2 * reverse_bits[i];
+}
+
+/*
+ * Count the fields of every float in a file, or of all 2^32 floats if path is "all", split
+ * evenly across threads. Each thread's histogram is added into the first at the end. Returns 0
+ * on success and -1 on failure.
+ */
+int histogram_floats(const char * path, int threads) {
+    mapped_floats floats = {NULL, (size_t) 1 << 32, 0};
+    int all_floats = strcmp(path, "all") == 0;
+    if (!all_floats && map_floats(path, &floats) != 0) {
+        return -1;
+    }
+    if (threads <= 0) {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    pthread_t * tids = (pthread_t *) malloc(threads * sizeof(pthread_t));
+    histogram_parameters * parameters = (histogram_parameters *)
+        calloc(threads, sizeof(histogram_parameters));
+    uint64_t total = floats.count;
+    double start = now();
+    for (int t = 0; t < threads; t++) {
+        parameters[t].values = floats.values;
+        parameters[t].start = total * t / threads;
+        parameters[t].end = total * (t + 1) / threads;
+        pthread_create(&tids[t], NULL, histogram_worker, &parameters[t]);
+    }
+    float_histogram * merged = &parameters[0].histogram;
+    pthread_join(tids[0], NULL);
+    for (int t = 1; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        // Every field of the histogram is a count, so it can be added as one flat array.
+        unsigned long * counts = (unsigned long *) &parameters[t].histogram;
+        unsigned long * merged_counts = (unsigned long *) merged;
+        for (size_t i = 0; i < sizeof(float_histogram) / sizeof(unsigned long); i++) {
+            merged_counts[i] += counts[i];
         }
-        
-        power_of_2 *= 0.5;
     }
-    printf("\t\tdecimal (with added one): %f\n", decimal_with_leading_one);
+    double seconds = now() - start;
+
+    print_histogram(merged, total);
+    printf("Counted %lu floats with %d threads in %lf seconds, %.1lf million floats/s\n",
+           (unsigned long) total, threads, seconds, seconds > 0 ? total / 1e6 / seconds : 0.0);
+    free(tids);
+    free(parameters);
+    if (!all_floats) {
+        unmap_floats(&floats);
+    }
+    return 0;
 }
 
+/*
+ * Build binary_digits, the eight characters '0' and '1' that spell each byte value in binary, so
+ * that a whole byte can be written with one copy instead of a division per bit.
+ */
+void init_binary_digits() {
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < 8; bit++) {
+            binary_digits[value][bit] = '0' + ((value >> (7 - bit)) & 1);
+        }
+    }
+}
 
 /*
- * Print the sign of a floating point number in binary and decimal using a clean text format.
+ * Write the lowest count bits of value in binary, most significant first. Returns the end of
+ * what was written.
  */
-void print_sign(unsigned int sign) {
-    printf("Sign:\n");
+char * write_bits(char * out, unsigned int value, int count) {
+    char digits[32];
+    for (int byte = 0; byte < 4; byte++) {
+        memcpy(digits + 8 * byte, binary_digits[(value >> (24 - 8 * byte)) & 0xff], 8);
+    }
+    memcpy(out, digits + 32 - count, count);
+    return out + count;
+}
+
+/*
+ * Write text without its null terminator. Returns the end of what was written.
+ */
+char * write_text(char * out, const char * text) {
+    size_t length = strlen(text);
+    memcpy(out, text, length);
+    return out + length;
+}
+
+/*
+ * Write an integer in decimal. Returns the end of what was written.
+ */
+char * write_int(char * out, int value) {
+    char digits[12];
+    int count = 0;
+    unsigned int magnitude = value < 0 ? -(unsigned int) value : (unsigned int) value;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        *out++ = '-';
+    }
+    while (count) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+/*
+ * Write the floating point input (interpreted as an unsigned integer) in binary without removing
+ * leading or trailing zeroes.
+ */
+char * format_input_binary(char * out, unsigned int decimal) {
+    out = write_text(out, "\nBinary Representation:\n");
+    out = write_bits(out, decimal, 32);
+    return write_text(out, "\n\n");
+}
+
+/*
+ * Write an unsigned decimal integer in binary, removing the leading zeroes; this will be used to
+ * write the exponent in binary. Counting the leading zeroes tells how many bits are left.
+ */
+char * format_binary(char * out, unsigned int decimal) {
+    out = write_text(out, "\t\tbinary: ");
+    out = write_bits(out, decimal, decimal ? 32 - __builtin_clz(decimal) : 0);
+    return write_text(out, "\n");
+}
+
+/*
+ * Write a mantissa in binary and decimal with its leading '1.' restored, removing trailing
+ * zeroes from the binary. The decimal value is (2^23 + mantissa) / 2^23, so it is printed exactly
+ * as %f would from integers alone: scaled by 10^6 for six decimals and rounded half to even.
+ */
+char * format_binary_and_decimal_with_leading_one(char * out, unsigned int decimal) {
+    out = write_text(out, "\t\tbinary (with added one): 1.");
+    if (decimal) {
+        int trailing_zeroes = __builtin_ctz(decimal);
+        out = write_bits(out, decimal >> trailing_zeroes, 23 - trailing_zeroes);
+    }
+    out = write_text(out, "\n\t\tdecimal (with added one): ");
+
+    uint64_t scaled = (uint64_t) ((1 << 23) | decimal) * 1000000;
+    uint64_t digits = scaled >> 23;
+    uint64_t remainder = scaled & ((1 << 23) - 1);
+    if (remainder > (1 << 22) || (remainder == (1 << 22) && (digits & 1))) {
+        ++digits;
+    }
+    out = write_int(out, (int) (digits / 1000000));
+    *out++ = '.';
+    unsigned int fraction = digits % 1000000;
+    for (int i = 5; i >= 0; i--) {
+        out[i] = '0' + fraction % 10;
+        fraction /= 10;
+    }
+    return write_text(out + 6, "\n");
+}
+
+/*
+ * Write the sign of a floating point number in binary and decimal using a clean text format.
+ */
+char * format_sign(char * out, unsigned int sign) {
     // Since a sign can only be a 0 or a 1, its representation in decimal is equivalent to its
     // representation in binary.
-    printf("\t\tbinary: %d\n", sign);
-    
-    printf("\t\tdecimal: %d\n", sign);
+    out = write_text(out, "Sign:\n\t\tbinary: ");
+    out = write_int(out, sign);
+    out = write_text(out, "\n\t\tdecimal: ");
+    out = write_int(out, sign);
+    return write_text(out, "\n");
+}
+
+/*
+ * Write in a clean format the exponent of a floating point number in binary and decimal,
+ * calculating the decimal value with bias and without.
+ */
+char * format_exponent(char * out, unsigned int exponent) {
+    out = write_text(out, "Exponent:\n");
+    out = format_binary(out, exponent);
+    out = write_text(out, "\t\tdecimal: ");
+    out = write_int(out, exponent);
+    // Calculate the actual value of the exponent by subtracting the bias, which is 2^k - 1.
+    out = write_text(out, "\n\t\twithout bias: ");
+    out = write_int(out, (int) exponent - 127);
+    return write_text(out, "\n");
+}
+
+/*
+ * Write in a clean format the mantissa of a floating point number in binary and decimal,
+ * calculating them by restoring the leading one.
+ */
+char * format_mantissa(char * out, unsigned int mantissa) {
+    out = write_text(out, "Mantissa:\n");
+    return format_binary_and_decimal_with_leading_one(out, mantissa);
+}
+
+/*
+ * Write the sign, exponent, and mantissa of a floating point number in a clean format.
+ */
+char * format_components(char * out, unsigned int sign, unsigned int exponent,
+                         unsigned int mantissa) {
+    out = format_sign(out, sign);
+    out = format_exponent(out, exponent);
+    return format_mantissa(out, mantissa);
+}
+
+/*
+ * Print the floating point input (interpreted as an unsigned integer) in binary
+ * without removing leading or trailing zeroes.
+ */
+void print_input_binary(unsigned int decimal) {
+    char text[MAX_REPORT_SIZE];
+    *format_input_binary(text, decimal) = '\0';
+    fputs(text, stdout);
+}
+
+/*
+ * Print an unsigned decimal integer in binary, removing the leading zeroes;
+ * this will be used to print the exponent in binary.
+ */
+void print_binary(unsigned int decimal) {
+    char text[MAX_REPORT_SIZE];
+    *format_binary(text, decimal) = '\0';
+    fputs(text, stdout);
+}
+
+/*
+ * Print numbers in binary and decimal that add a leading '1.' to a decimal input;
+ * this will be used to print the mantissa in binary and decimal while restoring the leading '1.'.
+ * When it prints the binary number, it removes trailing zeroes.
+ */
+void print_binary_and_decimal_with_leading_one(unsigned int decimal) {
+    char text[MAX_REPORT_SIZE];
+    *format_binary_and_decimal_with_leading_one(text, decimal) = '\0';
+    fputs(text, stdout);
+}
+
+/*
+ * Print the sign of a floating point number in binary and decimal using a clean text format.
+ */
+void print_sign(unsigned int sign) {
+    char text[MAX_REPORT_SIZE];
+    *format_sign(text, sign) = '\0';
+    fputs(text, stdout);
 }
 
 /*
@@ -204,15 +699,9 @@ void print_sign(unsigned int sign) {
  * calculating the decimal value with bias and without.
  */
 void print_exponent(unsigned int exponent) {
-    printf("Exponent:\n");
-    
-    print_binary(exponent);
-    
-    printf("\t\tdecimal: %d\n", exponent);
-    
-    // Calculate the actual value of the exponent by subtracting the bias, which is 2^k - 1.
-    int unbiased_exponent = exponent - 127;
-    printf("\t\twithout bias: %d\n", unbiased_exponent);
+    char text[MAX_REPORT_SIZE];
+    *format_exponent(text, exponent) = '\0';
+    fputs(text, stdout);
 }
 
 /*
@@ -220,20 +709,72 @@ void print_exponent(unsigned int exponent) {
  * calculating them by restoring the leading one.
  */
 void print_mantissa(unsigned int mantissa) {
-    printf("Mantissa:\n");
-    print_binary_and_decimal_with_leading_one(mantissa);
+    char text[MAX_REPORT_SIZE];
+    *format_mantissa(text, mantissa) = '\0';
+    fputs(text, stdout);
 }
 
 /*
  * Print the sign, exponent, and mantissa of a floating point number in a clean format.
  */
 void print_components(unsigned int sign, unsigned int exponent, unsigned int mantissa) {
-    print_sign(sign);
-    print_exponent(exponent);
-    print_mantissa(mantissa);
+    char text[MAX_REPORT_SIZE];
+    *format_components(text, sign, exponent, mantissa) = '\0';
+    fputs(text, stdout);
 }
 
-int main() {
+/*
+ * Write the binary representation and components of every float in a file to stdout, in the
+ * same format as the interactive prompt. Reports are built in a large buffer that is written
+ * out whenever it could not hold another one. Returns 0 on success and -1 on failure.
+ */
+int print_file(const char * path) {
+    mapped_floats floats;
+    if (map_floats(path, &floats) != 0) {
+        return -1;
+    }
+    char * buffer = (char *) malloc(OUTPUT_BUFFER_SIZE);
+    char * out = buffer;
+    int status = 0;
+    for (size_t i = 0; i < floats.count && status == 0; i++) {
+        unsigned int sign;
+        unsigned int exponent;
+        unsigned int mantissa;
+        parse_input(floats.values[i], &sign, &exponent, &mantissa);
+        out = format_input_binary(out, floats.values[i]);
+        out = format_components(out, sign, exponent, mantissa);
+        if (out - buffer > OUTPUT_BUFFER_SIZE - MAX_REPORT_SIZE || i + 1 == floats.count) {
+            size_t length = out - buffer;
+            if (fwrite(buffer, 1, length, stdout) != length) {
+                status = -1;
+            }
+            out = buffer;
+        }
+    }
+    free(buffer);
+    unmap_floats(&floats);
+    return status;
+}
+
+int main(int argc, char * argv[]) {
+    init_binary_digits();
+    if (argc > 1) {
+        if (strcmp(argv[1], "-d") == 0 && (argc == 3 || argc == 4)) {
+            return decompose_file(argv[2], argc == 4 ? argv[3] : NULL) == 0 ? EXIT_SUCCESS
+                                                                            : EXIT_FAILURE;
+        }
+        if (strcmp(argv[1], "-h") == 0 && (argc == 3 || argc == 4)) {
+            return histogram_floats(argv[2], argc == 4 ? atoi(argv[3]) : 0) == 0 ? EXIT_SUCCESS
+                                                                                 : EXIT_FAILURE;
+        }
+        if (strcmp(argv[1], "-p") == 0 && argc == 3) {
+            return print_file(argv[2]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        printf("Format: %s [-d float_file [output_prefix] | -h float_file|all [threads] | "
+               "-p float_file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
     converter input;
 
     printf("Please input a floating point number: ");
@@ -0,0 +1,788 @@
+/*
+ * Conversion of floats and doubles to decimal text without printf. Fixed precision output takes
+ * a fast path through a 64 bit integer whenever fma shows the rounding is not in doubt, and
+ * otherwise expands the exact binary value with big integers. Shortest output is generated with
+ * 64 bit integers as in Loitsch's Grisu3, and when that can not be sure of its answer, from the
+ * exact value and the gaps to its neighbors as in Steele and White's Dragon4 with the free-format
+ * refinements of Burger and Dybvig.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "float_format.h"
+
+// Enough 32 bit limbs for every big integer either algorithm builds from a double, the largest
+// being about 1140 bits.
+#define BIG_LIMBS 40
+// The fast path is only taken while value * 10^precision fits a double's 53 bit integers.
+#define MAX_FAST_PRECISION 15
+
+/*
+ * An unsigned integer of up to BIG_LIMBS 32 bit limbs, least significant first. length counts
+ * the limbs in use, and the highest of them is never 0.
+ */
+typedef struct big {
+    int length;
+    uint32_t limbs[BIG_LIMBS];
+} big;
+
+static const uint64_t powers_of_10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL,
+};
+
+/*
+ * Set a big integer to value.
+ */
+static void big_set(big * b, uint64_t value) {
+    b->limbs[0] = (uint32_t) value;
+    b->limbs[1] = (uint32_t) (value >> 32);
+    b->length = b->limbs[1] ? 2 : b->limbs[0] ? 1 : 0;
+}
+
+/*
+ * Drop limbs of 0 from the top.
+ */
+static void big_trim(big * b) {
+    while (b->length > 0 && b->limbs[b->length - 1] == 0) {
+        --b->length;
+    }
+}
+
+/*
+ * Multiply a big integer by a 32 bit factor.
+ */
+static void big_multiply_small(big * b, uint32_t factor) {
+    uint64_t carry = 0;
+    for (int i = 0; i < b->length; i++) {
+        uint64_t product = (uint64_t) b->limbs[i] * factor + carry;
+        b->limbs[i] = (uint32_t) product;
+        carry = product >> 32;
+    }
+    if (carry) {
+        b->limbs[b->length++] = (uint32_t) carry;
+    }
+}
+
+/*
+ * Multiply a big integer by 10^exponent, nine digits at a time.
+ */
+static void big_multiply_power_of_10(big * b, int exponent) {
+    for (; exponent >= 9; exponent -= 9) {
+        big_multiply_small(b, 1000000000);
+    }
+    if (exponent > 0) {
+        big_multiply_small(b, (uint32_t) powers_of_10[exponent]);
+    }
+}
+
+/*
+ * Multiply a big integer by 2^shift.
+ */
+static void big_shift_left(big * b, int shift) {
+    if (b->length == 0) {
+        return;
+    }
+    int limbs = shift / 32;
+    int bits = shift % 32;
+    b->limbs[b->length + limbs] = 0;
+    for (int i = b->length - 1; i >= 0; i--) {
+        uint32_t limb = b->limbs[i];
+        if (bits) {
+            b->limbs[i + limbs + 1] |= limb >> (32 - bits);
+        }
+        b->limbs[i + limbs] = limb << bits;
+    }
+    for (int i = 0; i < limbs; i++) {
+        b->limbs[i] = 0;
+    }
+    b->length += limbs + 1;
+    big_trim(b);
+}
+
+/*
+ * Returns less than, equal to, or greater than 0 as a is less than, equal to, or greater than b.
+ */
+static int big_compare(const big * a, const big * b) {
+    if (a->length != b->length) {
+        return a->length < b->length ? -1 : 1;
+    }
+    for (int i = a->length - 1; i >= 0; i--) {
+        if (a->limbs[i] != b->limbs[i]) {
+            return a->limbs[i] < b->limbs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Set sum to a + b. sum may be a or b.
+ */
+static void big_add(big * sum, const big * a, const big * b) {
+    int length = a->length > b->length ? a->length : b->length;
+    uint64_t carry = 0;
+    for (int i = 0; i < length; i++) {
+        carry += (uint64_t) (i < a->length ? a->limbs[i] : 0) + (i < b->length ? b->limbs[i] : 0);
+        sum->limbs[i] = (uint32_t) carry;
+        carry >>= 32;
+    }
+    sum->length = length;
+    if (carry) {
+        sum->limbs[sum->length++] = (uint32_t) carry;
+    }
+}
+
+/*
+ * Subtract b from a, which must be at least b.
+ */
+static void big_subtract(big * a, const big * b) {
+    int64_t borrow = 0;
+    for (int i = 0; i < a->length; i++) {
+        borrow += (int64_t) a->limbs[i] - (i < b->length ? b->limbs[i] : 0);
+        a->limbs[i] = (uint32_t) borrow;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+    big_trim(a);
+}
+
+/*
+ * Divide a big integer by a 32 bit divisor and return the remainder.
+ */
+static uint32_t big_divide_small(big * b, uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (int i = b->length - 1; i >= 0; i--) {
+        uint64_t part = (remainder << 32) | b->limbs[i];
+        b->limbs[i] = (uint32_t) (part / divisor);
+        remainder = part % divisor;
+    }
+    big_trim(b);
+    return (uint32_t) remainder;
+}
+
+/*
+ * Remove the bits of a big integer from bit shift up and return them. They must fit in 32 bits.
+ */
+static uint32_t big_split(big * b, int shift) {
+    int limb = shift / 32;
+    int bits = shift % 32;
+    if (limb >= b->length) {
+        return 0;
+    }
+    uint64_t above = b->limbs[limb] >> bits;
+    if (limb + 1 < b->length) {
+        above |= (uint64_t) b->limbs[limb + 1] << (32 - bits);
+    }
+    b->limbs[limb] &= (uint32_t) ((1ULL << bits) - 1);
+    b->length = limb + 1;
+    big_trim(b);
+    return (uint32_t) above;
+}
+
+/*
+ * Write an unsigned integer in decimal and return the length written.
+ */
+static int write_unsigned(char * out, uint64_t value) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    for (int i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+/*
+ * Write a big integer in decimal and return the length written. It is divided down nine digits
+ * at a time, and the groups are written from the most significant.
+ */
+static int write_big(char * out, big * b) {
+    uint32_t groups[BIG_LIMBS * 10 / 9 + 1];
+    int count = 0;
+    do {
+        groups[count++] = big_divide_small(b, 1000000000);
+    } while (b->length > 0);
+    int length = write_unsigned(out, groups[--count]);
+    while (count > 0) {
+        uint32_t group = groups[--count];
+        for (int i = 8; i >= 0; i--) {
+            out[length + i] = '0' + group % 10;
+            group /= 10;
+        }
+        length += 9;
+    }
+    return length;
+}
+
+/*
+ * Write infinity or NaN the way printf does and return the length written.
+ */
+static int write_special(char * out, double value) {
+    const char * text = isnan(value) ? (signbit(value) ? "-nan" : "nan")
+                                     : (signbit(value) ? "-inf" : "inf");
+    strcpy(out, text);
+    return (int) strlen(text);
+}
+
+/*
+ * Split a finite double into its integer mantissa and power of two: value is mantissa * 2^exponent.
+ */
+static void split_double(double value, uint64_t * mantissa, int * exponent) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int) ((bits >> 52) & 0x7ff);
+    *mantissa = bits & ((1ULL << 52) - 1);
+    if (biased == 0) {
+        *exponent = -1074;
+    } else {
+        *mantissa |= 1ULL << 52;
+        *exponent = biased - 1075;
+    }
+}
+
+/*
+ * Write the digits of magnitude rounded to precision decimals when that can be done in a 64 bit
+ * integer. Returns the length written, or 0 if the value is too large or too close to halfway
+ * between two results for the fast path to be sure of the rounding.
+ */
+static int format_fixed_fast(char * out, double magnitude, int precision) {
+    if (precision > MAX_FAST_PRECISION ||
+        !(magnitude * powers_of_10[precision] < 9007199254740992.0)) {
+        return 0;
+    }
+    // scaled + error is exactly magnitude * 10^precision, so the distance to the nearest whole
+    // number is known well enough to round the way printf does whenever it is clearly not a tie.
+    double scale = (double) powers_of_10[precision];
+    double scaled = magnitude * scale;
+    double error = fma(magnitude, scale, -scaled);
+    double rounded = nearbyint(scaled);
+    if (fabs((scaled - rounded) + error) > 0.5 - 1.0 / (1 << 20)) {
+        return 0;
+    }
+
+    uint64_t digits = (uint64_t) rounded;
+    int length = write_unsigned(out, digits / powers_of_10[precision]);
+    if (precision > 0) {
+        uint64_t fraction = digits % powers_of_10[precision];
+        out[length++] = '.';
+        for (int i = precision - 1; i >= 0; i--) {
+            out[length + i] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        length += precision;
+    }
+    return length;
+}
+
+/*
+ * Write the digits of magnitude rounded to precision decimals from its exact binary value, and
+ * return the length written. The fraction is a big integer over 2^-exponent; multiplying it by 10
+ * moves the next decimal digit above the binary point. What is left after the last digit decides
+ * the rounding, with exact ties going to the even digit as printf does.
+ */
+static int format_fixed_exact(char * out, double magnitude, int precision) {
+    uint64_t mantissa;
+    int exponent;
+    split_double(magnitude, &mantissa, &exponent);
+    big number;
+    int length;
+    if (exponent >= 0) {
+        // Whole numbers have nothing to round.
+        big_set(&number, mantissa);
+        big_shift_left(&number, exponent);
+        length = write_big(out, &number);
+        if (precision > 0) {
+            out[length++] = '.';
+            memset(out + length, '0', precision);
+            length += precision;
+        }
+        return length;
+    }
+
+    int fraction_bits = -exponent;
+    uint64_t whole = fraction_bits < 64 ? mantissa >> fraction_bits : 0;
+    big_set(&number, fraction_bits < 64 ? mantissa & ((1ULL << fraction_bits) - 1) : mantissa);
+    length = write_unsigned(out, whole);
+    if (precision > 0) {
+        out[length++] = '.';
+    }
+    for (int i = 0; i < precision; i++) {
+        big_multiply_small(&number, 10);
+        out[length++] = '0' + big_split(&number, fraction_bits);
+    }
+
+    big half;
+    big_set(&half, 1);
+    big_shift_left(&half, fraction_bits - 1);
+    int comparison = big_compare(&number, &half);
+    char last = out[length - 1] == '.' ? out[length - 2] : out[length - 1];
+    if (comparison > 0 || (comparison == 0 && (last - '0') % 2 == 1)) {
+        // Round up, carrying through 9s. If the carry runs off the front, the result gains a
+        // leading 1 and every other digit is already 0.
+        int i = length - 1;
+        for (; i >= 0; i--) {
+            if (out[i] == '.') {
+                continue;
+            }
+            if (out[i] != '9') {
+                ++out[i];
+                break;
+            }
+            out[i] = '0';
+        }
+        if (i < 0) {
+            memmove(out + 1, out, length);
+            out[0] = '1';
+            ++length;
+        }
+    }
+    return length;
+}
+
+int format_fixed(char * out, double value, int precision) {
+    if (precision < 0) {
+        precision = 6;
+    }
+    if (isinf(value) || isnan(value)) {
+        return write_special(out, value);
+    }
+    int length = 0;
+    // printf keeps the sign of negative values that round to zero, as in -0.00.
+    if (signbit(value)) {
+        out[length++] = '-';
+    }
+    double magnitude = fabs(value);
+    int written = format_fixed_fast(out + length, magnitude, precision);
+    if (written == 0) {
+        written = format_fixed_exact(out + length, magnitude, precision);
+    }
+    length += written;
+    out[length] = '\0';
+    return length;
+}
+
+/*
+ * Generate the shortest digits that read back as mantissa * 2^exponent in a format with
+ * mantissa_bits bits of precision and smallest exponent min_exponent. The value is
+ * 0.digits * 10^decimal_exponent. Returns the number of digits.
+ *
+ * r / s is the value and m_plus / s and m_minus / s are half the gaps to its neighbors, all
+ * scaled by 10^-decimal_exponent so the value is below 1. Each step multiplies by 10 and takes
+ * the integer part as the next digit, stopping as soon as the digits so far, or the same with the
+ * last digit one higher, are inside the range that reads back as the value.
+ */
+static int shortest_digits(uint64_t mantissa, int exponent, int mantissa_bits, int min_exponent,
+                           char * digits, int * decimal_exponent) {
+    big r;
+    big s;
+    big m_plus;
+    big m_minus;
+    // The gap above is twice the gap below when the mantissa is the lowest of its binade.
+    int unequal_gaps = mantissa == (1ULL << (mantissa_bits - 1)) && exponent > min_exponent;
+    big_set(&r, mantissa);
+    big_set(&s, 1);
+    big_set(&m_minus, 1);
+    if (exponent >= 0) {
+        big_shift_left(&r, exponent + 1 + unequal_gaps);
+        big_shift_left(&s, 1 + unequal_gaps);
+        big_shift_left(&m_minus, exponent);
+    } else {
+        big_shift_left(&r, 1 + unequal_gaps);
+        big_shift_left(&s, -exponent + 1 + unequal_gaps);
+    }
+    m_plus = m_minus;
+    if (unequal_gaps) {
+        big_shift_left(&m_plus, 1);
+    }
+    // Even mantissas win ties when read back, so the ends of their range read back as them too.
+    int inclusive = (mantissa & 1) == 0;
+
+    // Estimate the decimal exponent from the binary one. It can only be one too low, which the
+    // check below corrects.
+    int bits = 64 - __builtin_clzll(mantissa);
+    int k = (int) ceil((exponent + bits - 1) * 0.30102999566398114 - 1e-10);
+    if (k >= 0) {
+        big_multiply_power_of_10(&s, k);
+    } else {
+        big_multiply_power_of_10(&r, -k);
+        big_multiply_power_of_10(&m_plus, -k);
+        big_multiply_power_of_10(&m_minus, -k);
+    }
+    big high;
+    big_add(&high, &r, &m_plus);
+    int comparison = big_compare(&high, &s);
+    if (comparison > 0 || (comparison == 0 && inclusive)) {
+        big_multiply_small(&s, 10);
+        ++k;
+    }
+    *decimal_exponent = k;
+
+    int count = 0;
+    while (1) {
+        big_multiply_small(&r, 10);
+        big_multiply_small(&m_plus, 10);
+        big_multiply_small(&m_minus, 10);
+        int digit = 0;
+        while (big_compare(&r, &s) >= 0) {
+            big_subtract(&r, &s);
+            ++digit;
+        }
+        comparison = big_compare(&r, &m_minus);
+        int low = comparison < 0 || (comparison == 0 && inclusive);
+        big_add(&high, &r, &m_plus);
+        comparison = big_compare(&high, &s);
+        int up = comparison > 0 || (comparison == 0 && inclusive);
+        if (low && up) {
+            // Both digits read back as the value, so take the one nearer to it.
+            big twice;
+            big_add(&twice, &r, &r);
+            comparison = big_compare(&twice, &s);
+            if (comparison > 0 || (comparison == 0 && digit % 2 == 1)) {
+                ++digit;
+            }
+        } else if (up) {
+            ++digit;
+        }
+        digits[count++] = '0' + digit;
+        if (low || up) {
+            return count;
+        }
+    }
+}
+
+/*
+ * A 64 bit mantissa and a power of two, value = f * 2^e, for the fast shortest path.
+ */
+typedef struct diy_fp {
+    uint64_t f;
+    int e;
+} diy_fp;
+
+/*
+ * 10^decimal_exponent rounded to a 64 bit mantissa with its top bit set, times
+ * 2^binary_exponent, for every 8th decimal exponent from -348 to 340.
+ */
+typedef struct cached_power {
+    uint64_t significand;
+    int binary_exponent;
+    int decimal_exponent;
+} cached_power;
+
+static const cached_power cached_powers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220, -348},
+    {0xbaaee17fa23ebf76ULL, -1193, -340},
+    {0x8b16fb203055ac76ULL, -1166, -332},
+    {0xcf42894a5dce35eaULL, -1140, -324},
+    {0x9a6bb0aa55653b2dULL, -1113, -316},
+    {0xe61acf033d1a45dfULL, -1087, -308},
+    {0xab70fe17c79ac6caULL, -1060, -300},
+    {0xff77b1fcbebcdc4fULL, -1034, -292},
+    {0xbe5691ef416bd60cULL, -1007, -284},
+    {0x8dd01fad907ffc3cULL, -980, -276},
+    {0xd3515c2831559a83ULL, -954, -268},
+    {0x9d71ac8fada6c9b5ULL, -927, -260},
+    {0xea9c227723ee8bcbULL, -901, -252},
+    {0xaecc49914078536dULL, -874, -244},
+    {0x823c12795db6ce57ULL, -847, -236},
+    {0xc21094364dfb5637ULL, -821, -228},
+    {0x9096ea6f3848984fULL, -794, -220},
+    {0xd77485cb25823ac7ULL, -768, -212},
+    {0xa086cfcd97bf97f4ULL, -741, -204},
+    {0xef340a98172aace5ULL, -715, -196},
+    {0xb23867fb2a35b28eULL, -688, -188},
+    {0x84c8d4dfd2c63f3bULL, -661, -180},
+    {0xc5dd44271ad3cdbaULL, -635, -172},
+    {0x936b9fcebb25c996ULL, -608, -164},
+    {0xdbac6c247d62a584ULL, -582, -156},
+    {0xa3ab66580d5fdaf6ULL, -555, -148},
+    {0xf3e2f893dec3f126ULL, -529, -140},
+    {0xb5b5ada8aaff80b8ULL, -502, -132},
+    {0x87625f056c7c4a8bULL, -475, -124},
+    {0xc9bcff6034c13053ULL, -449, -116},
+    {0x964e858c91ba2655ULL, -422, -108},
+    {0xdff9772470297ebdULL, -396, -100},
+    {0xa6dfbd9fb8e5b88fULL, -369, -92},
+    {0xf8a95fcf88747d94ULL, -343, -84},
+    {0xb94470938fa89bcfULL, -316, -76},
+    {0x8a08f0f8bf0f156bULL, -289, -68},
+    {0xcdb02555653131b6ULL, -263, -60},
+    {0x993fe2c6d07b7facULL, -236, -52},
+    {0xe45c10c42a2b3b06ULL, -210, -44},
+    {0xaa242499697392d3ULL, -183, -36},
+    {0xfd87b5f28300ca0eULL, -157, -28},
+    {0xbce5086492111aebULL, -130, -20},
+    {0x8cbccc096f5088ccULL, -103, -12},
+    {0xd1b71758e219652cULL, -77, -4},
+    {0x9c40000000000000ULL, -50, 4},
+    {0xe8d4a51000000000ULL, -24, 12},
+    {0xad78ebc5ac620000ULL, 3, 20},
+    {0x813f3978f8940984ULL, 30, 28},
+    {0xc097ce7bc90715b3ULL, 56, 36},
+    {0x8f7e32ce7bea5c70ULL, 83, 44},
+    {0xd5d238a4abe98068ULL, 109, 52},
+    {0x9f4f2726179a2245ULL, 136, 60},
+    {0xed63a231d4c4fb27ULL, 162, 68},
+    {0xb0de65388cc8ada8ULL, 189, 76},
+    {0x83c7088e1aab65dbULL, 216, 84},
+    {0xc45d1df942711d9aULL, 242, 92},
+    {0x924d692ca61be758ULL, 269, 100},
+    {0xda01ee641a708deaULL, 295, 108},
+    {0xa26da3999aef774aULL, 322, 116},
+    {0xf209787bb47d6b85ULL, 348, 124},
+    {0xb454e4a179dd1877ULL, 375, 132},
+    {0x865b86925b9bc5c2ULL, 402, 140},
+    {0xc83553c5c8965d3dULL, 428, 148},
+    {0x952ab45cfa97a0b3ULL, 455, 156},
+    {0xde469fbd99a05fe3ULL, 481, 164},
+    {0xa59bc234db398c25ULL, 508, 172},
+    {0xf6c69a72a3989f5cULL, 534, 180},
+    {0xb7dcbf5354e9beceULL, 561, 188},
+    {0x88fcf317f22241e2ULL, 588, 196},
+    {0xcc20ce9bd35c78a5ULL, 614, 204},
+    {0x98165af37b2153dfULL, 641, 212},
+    {0xe2a0b5dc971f303aULL, 667, 220},
+    {0xa8d9d1535ce3b396ULL, 694, 228},
+    {0xfb9b7cd9a4a7443cULL, 720, 236},
+    {0xbb764c4ca7a44410ULL, 747, 244},
+    {0x8bab8eefb6409c1aULL, 774, 252},
+    {0xd01fef10a657842cULL, 800, 260},
+    {0x9b10a4e5e9913129ULL, 827, 268},
+    {0xe7109bfba19c0c9dULL, 853, 276},
+    {0xac2820d9623bf429ULL, 880, 284},
+    {0x80444b5e7aa7cf85ULL, 907, 292},
+    {0xbf21e44003acdd2dULL, 933, 300},
+    {0x8e679c2f5e44ff8fULL, 960, 308},
+    {0xd433179d9c8cb841ULL, 986, 316},
+    {0x9e19db92b4e31ba9ULL, 1013, 324},
+    {0xeb96bf6ebadf77d9ULL, 1039, 332},
+    {0xaf87023b9bf0ee6bULL, 1066, 340},
+};
+
+/*
+ * Shift a diy_fp left until the top bit of its mantissa is set.
+ */
+static diy_fp normalize(diy_fp x) {
+    int shift = __builtin_clzll(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
+
+/*
+ * Multiply two diy_fps, keeping the top 64 bits of the product rounded to nearest.
+ */
+static diy_fp multiply(diy_fp x, diy_fp y) {
+    uint64_t a = x.f >> 32;
+    uint64_t b = x.f & 0xffffffff;
+    uint64_t c = y.f >> 32;
+    uint64_t d = y.f & 0xffffffff;
+    uint64_t middle = (b * d >> 32) + (a * d & 0xffffffff) + (b * c & 0xffffffff);
+    // Round the bits that are dropped.
+    middle += 1U << 31;
+    diy_fp product = {a * c + (a * d >> 32) + (b * c >> 32) + (middle >> 32), x.e + y.e + 64};
+    return product;
+}
+
+/*
+ * Move the last digit down while that brings it closer to the value, and report whether the
+ * result is certainly the closest shortest one. The distances are all scaled like rest, the
+ * distance from the digits to the top of the unsafe interval, in which everything that may read
+ * back as the value lies. unit is the largest error in any of them.
+ */
+static int round_weed(char * digits, int count, uint64_t distance_too_high_w,
+                      uint64_t unsafe_interval, uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_distance = distance_too_high_w - unit;
+    uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance ||
+            small_distance - rest >= rest + ten_kappa - small_distance)) {
+        --digits[count - 1];
+        rest += ten_kappa;
+    }
+    // Give up if the errors leave it unclear which of two results is closer.
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance ||
+         big_distance - rest > rest + ten_kappa - big_distance)) {
+        return 0;
+    }
+    // Give up unless the result is certainly inside the safe interval.
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+/*
+ * Try to generate the shortest digits as shortest_digits does using 64 bit integers alone, as in
+ * Loitsch's Grisu3. The value and its bounds are scaled by a cached power of ten into a range
+ * where the integer part fits 32 bits, and digits are taken from the upper bound until the rest
+ * falls inside the interval. Returns the number of digits, or 0 if the error in the scaling
+ * leaves the answer in doubt, which happens for about 1 value in 200.
+ */
+static int grisu_digits(uint64_t mantissa, int exponent, int mantissa_bits, int min_exponent,
+                        char * digits, int * decimal_exponent) {
+    diy_fp v = {mantissa, exponent};
+    diy_fp w = normalize(v);
+    diy_fp plus = {(mantissa << 1) + 1, exponent - 1};
+    plus = normalize(plus);
+    diy_fp minus = {(mantissa << 1) - 1, exponent - 1};
+    if (mantissa == (1ULL << (mantissa_bits - 1)) && exponent > min_exponent) {
+        minus.f = (mantissa << 2) - 1;
+        minus.e = exponent - 2;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // Pick the power that brings the binary exponent of the scaled value to between -60 and -32.
+    int min_binary_exponent = -60 - (w.e + 64);
+    int k = (int) ceil((min_binary_exponent + 63) * 0.30102999566398114);
+    cached_power power = cached_powers[(348 + k - 1) / 8 + 1];
+    diy_fp ten_mk = {power.significand, power.binary_exponent};
+    w = multiply(w, ten_mk);
+    plus = multiply(plus, ten_mk);
+    minus = multiply(minus, ten_mk);
+
+    // Each product may be off by up to one, so widen the interval by one on either side.
+    uint64_t unit = 1;
+    uint64_t too_low = minus.f - unit;
+    uint64_t too_high = plus.f + unit;
+    uint64_t unsafe_interval = too_high - too_low;
+    int shift = -w.e;
+    uint64_t one = 1ULL << shift;
+    uint32_t integrals = (uint32_t) (too_high >> shift);
+    uint64_t fractionals = too_high & (one - 1);
+
+    uint32_t divisor = 1;
+    int kappa = 1;
+    while (integrals / divisor >= 10) {
+        divisor *= 10;
+        ++kappa;
+    }
+    int count = 0;
+    while (kappa > 0) {
+        digits[count++] = '0' + integrals / divisor;
+        integrals %= divisor;
+        --kappa;
+        uint64_t rest = ((uint64_t) integrals << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            *decimal_exponent = kappa - power.decimal_exponent + count;
+            return round_weed(digits, count, too_high - w.f, unsafe_interval, rest,
+                              (uint64_t) divisor << shift, unit) ? count : 0;
+        }
+        divisor /= 10;
+    }
+    while (1) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digits[count++] = '0' + (fractionals >> shift);
+        fractionals &= one - 1;
+        --kappa;
+        if (fractionals < unsafe_interval) {
+            *decimal_exponent = kappa - power.decimal_exponent + count;
+            return round_weed(digits, count, (too_high - w.f) * unit, unsafe_interval,
+                              fractionals, one, unit) ? count : 0;
+        }
+    }
+}
+
+/*
+ * Write digits scaled by 10^decimal_exponent as printf's "%g" would lay them out, with a plain
+ * decimal for exponents from -4 up to 16 and scientific notation otherwise. Returns the length
+ * written.
+ */
+static int layout_digits(char * out, const char * digits, int count, int decimal_exponent) {
+    int length = 0;
+    int scientific = decimal_exponent - 1;
+    if (scientific < -4 || scientific >= 17) {
+        out[length++] = digits[0];
+        if (count > 1) {
+            out[length++] = '.';
+            memcpy(out + length, digits + 1, count - 1);
+            length += count - 1;
+        }
+        out[length++] = 'e';
+        out[length++] = scientific < 0 ? '-' : '+';
+        int magnitude = scientific < 0 ? -scientific : scientific;
+        if (magnitude < 10) {
+            out[length++] = '0';
+        }
+        length += write_unsigned(out + length, (uint64_t) magnitude);
+    } else if (decimal_exponent <= 0) {
+        out[length++] = '0';
+        out[length++] = '.';
+        memset(out + length, '0', -decimal_exponent);
+        length += -decimal_exponent;
+        memcpy(out + length, digits, count);
+        length += count;
+    } else if (count <= decimal_exponent) {
+        memcpy(out + length, digits, count);
+        length += count;
+        memset(out + length, '0', decimal_exponent - count);
+        length += decimal_exponent - count;
+    } else {
+        memcpy(out + length, digits, decimal_exponent);
+        length += decimal_exponent;
+        out[length++] = '.';
+        memcpy(out + length, digits + decimal_exponent, count - decimal_exponent);
+        length += count - decimal_exponent;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+/*
+ * Write a finite nonzero value given as mantissa * 2^exponent in its shortest form.
+ */
+static int format_shortest_parts(char * out, int negative, uint64_t mantissa, int exponent,
+                                 int mantissa_bits, int min_exponent) {
+    char digits[20];
+    int decimal_exponent;
+    int count = grisu_digits(mantissa, exponent, mantissa_bits, min_exponent, digits,
+                             &decimal_exponent);
+    if (count == 0) {
+        count = shortest_digits(mantissa, exponent, mantissa_bits, min_exponent, digits,
+                                &decimal_exponent);
+    }
+    int length = 0;
+    if (negative) {
+        out[length++] = '-';
+    }
+    return length + layout_digits(out + length, digits, count, decimal_exponent);
+}
+
+int format_shortest(char * out, double value) {
+    if (isinf(value) || isnan(value)) {
+        return write_special(out, value);
+    }
+    if (value == 0) {
+        strcpy(out, signbit(value) ? "-0" : "0");
+        return signbit(value) ? 2 : 1;
+    }
+    uint64_t mantissa;
+    int exponent;
+    split_double(fabs(value), &mantissa, &exponent);
+    return format_shortest_parts(out, signbit(value) != 0, mantissa, exponent, 53, -1074);
+}
+
+int format_shortest_float(char * out, float value) {
+    if (isinf(value) || isnan(value)) {
+        return write_special(out, value);
+    }
+    if (value == 0) {
+        strcpy(out, signbit(value) ? "-0" : "0");
+        return signbit(value) ? 2 : 1;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int) ((bits >> 23) & 0xff);
+    uint64_t mantissa = bits & ((1U << 23) - 1);
+    int exponent = -149;
+    if (biased != 0) {
+        mantissa |= 1U << 23;
+        exponent = biased - 150;
+    }
+    return format_shortest_parts(out, signbit(value) != 0, mantissa, exponent, 24, -149);
+}
@@ -0,0 +1,35 @@
+/*
+ * Conversion of floats and doubles to decimal text without printf.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#ifndef FLOAT_FORMAT_H
+#define FLOAT_FORMAT_H
+
+// Room for any double with precision decimals: a sign, 309 integer digits, the point, and the
+// null terminator.
+#define FORMAT_FIXED_SIZE(precision) (312 + (precision))
+// Room for the shortest form of any double or float, such as -2.2250738585072014e-308.
+#define FORMAT_SHORTEST_SIZE 32
+
+/*
+ * Write value with precision digits after the decimal point, exactly as printf's "%.*f" does in
+ * the C locale, and return the length written. out must hold FORMAT_FIXED_SIZE(precision)
+ * characters. A negative precision means 6, as for printf.
+ */
+int format_fixed(char * out, double value, int precision);
+
+/*
+ * Write the fewest significant digits that read back as exactly value, and return the length
+ * written. Values from 1e-4 up to 1e17 are written as plain decimals and others in scientific
+ * notation, like printf's "%g", so 0.1 is "0.1", 100 is "100", and 1e100 is "1e+100". out must
+ * hold FORMAT_SHORTEST_SIZE characters.
+ */
+int format_shortest(char * out, double value);
+
+/*
+ * The same as format_shortest, with the fewest digits that read back as exactly the float value.
+ */
+int format_shortest_float(char * out, float value);
+
+#endif
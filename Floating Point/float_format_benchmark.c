@@ -0,0 +1,197 @@
+/*
+ * Program to compare formatting doubles and floats with float_format against snprintf, checking
+ * that fixed precision output is the same byte for byte and that shortest output reads back as
+ * the same value.
+ * Format: ./float_format_benchmark [values]
+ * Compile with: gcc -O2 float_format_benchmark.c float_format.c -lm
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "float_format.h"
+
+#define DEFAULT_VALUES 1000000
+// Longest line either formatter writes for the values benchmarked here.
+#define LINE_SIZE FORMAT_FIXED_SIZE(6)
+
+/*
+ * Obtain the current time in seconds.
+ */
+double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/*
+ * Obtain 64 random bits.
+ */
+uint64_t random_bits() {
+    return ((uint64_t) rand() << 62) ^ ((uint64_t) rand() << 31) ^ (uint64_t) rand();
+}
+
+/*
+ * Obtain a random finite double with any bit pattern.
+ */
+double random_double() {
+    double value;
+    do {
+        uint64_t bits = random_bits();
+        memcpy(&value, &bits, sizeof(value));
+    } while (isinf(value) || isnan(value));
+    return value;
+}
+
+/*
+ * Obtain a random finite float with any bit pattern.
+ */
+float random_float() {
+    float value;
+    do {
+        uint32_t bits = (uint32_t) random_bits();
+        memcpy(&value, &bits, sizeof(value));
+    } while (isinf(value) || isnan(value));
+    return value;
+}
+
+/*
+ * Time formatting every value with precision decimals through snprintf and through format_fixed,
+ * and count the values where the two differ.
+ */
+void benchmark_fixed(const char * name, const double * values, size_t count, int precision) {
+    char expected[LINE_SIZE];
+    char line[LINE_SIZE];
+    size_t total = 0;
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        total += snprintf(line, sizeof(line), "%.*f", precision, values[i]);
+    }
+    double printf_seconds = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++) {
+        total += format_fixed(line, values[i], precision);
+    }
+    double format_seconds = now() - start;
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        snprintf(expected, sizeof(expected), "%.*f", precision, values[i]);
+        format_fixed(line, values[i], precision);
+        if (strcmp(expected, line) != 0) {
+            ++mismatches;
+        }
+    }
+    printf("%-24s snprintf %8.1lf ns  format %8.1lf ns (%.1lfx)  %s\n", name,
+           printf_seconds * 1e9 / count, format_seconds * 1e9 / count,
+           printf_seconds / format_seconds, mismatches == 0 ? "identical" : "MISMATCH");
+    // Keep the compiler from dropping the loops.
+    if (total == 0) {
+        printf("\n");
+    }
+}
+
+/*
+ * Time formatting every double with enough digits to read back through snprintf and with the
+ * fewest that read back through format_shortest, and count the values that do not read back.
+ */
+void benchmark_shortest(const char * name, const double * values, size_t count) {
+    char line[FORMAT_SHORTEST_SIZE];
+    size_t printf_length = 0;
+    size_t format_length = 0;
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        printf_length += snprintf(line, sizeof(line), "%.17g", values[i]);
+    }
+    double printf_seconds = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++) {
+        format_length += format_shortest(line, values[i]);
+    }
+    double format_seconds = now() - start;
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        format_shortest(line, values[i]);
+        if (strtod(line, NULL) != values[i]) {
+            ++mismatches;
+        }
+    }
+    printf("%-24s snprintf %8.1lf ns  format %8.1lf ns (%.1lfx)  %s, %.1lf characters instead "
+           "of %.1lf\n", name, printf_seconds * 1e9 / count, format_seconds * 1e9 / count,
+           printf_seconds / format_seconds, mismatches == 0 ? "round trips" : "MISMATCH",
+           (double) format_length / count, (double) printf_length / count);
+}
+
+/*
+ * The same for floats, against the 9 digits that always read back as a float.
+ */
+void benchmark_shortest_float(const char * name, const float * values, size_t count) {
+    char line[FORMAT_SHORTEST_SIZE];
+    size_t printf_length = 0;
+    size_t format_length = 0;
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        printf_length += snprintf(line, sizeof(line), "%.9g", values[i]);
+    }
+    double printf_seconds = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++) {
+        format_length += format_shortest_float(line, values[i]);
+    }
+    double format_seconds = now() - start;
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        format_shortest_float(line, values[i]);
+        if (strtof(line, NULL) != values[i]) {
+            ++mismatches;
+        }
+    }
+    printf("%-24s snprintf %8.1lf ns  format %8.1lf ns (%.1lfx)  %s, %.1lf characters instead "
+           "of %.1lf\n", name, printf_seconds * 1e9 / count, format_seconds * 1e9 / count,
+           printf_seconds / format_seconds, mismatches == 0 ? "round trips" : "MISMATCH",
+           (double) format_length / count, (double) printf_length / count);
+}
+
+int main(int argc, char * argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_VALUES;
+    if (argc > 2 || count == 0) {
+        printf("Format: ./float_format_benchmark [values]\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    double * temperatures = (double *) malloc(count * sizeof(double));
+    double * mantissas = (double *) malloc(count * sizeof(double));
+    double * doubles = (double *) malloc(count * sizeof(double));
+    float * floats = (float *) malloc(count * sizeof(float));
+    for (size_t i = 0; i < count; i++) {
+        // Celsius readings converted to Fahrenheit, as the temperature converters print them.
+        temperatures[i] = (rand() % 20001 - 5000) / 10.0 * 9 / 5 + 32;
+        // The value of a float's mantissa with its leading one, as float_fields prints it.
+        mantissas[i] = 1 + (double) (rand() & 0x7fffff) / (1 << 23);
+        doubles[i] = random_double();
+        floats[i] = random_float();
+    }
+
+    printf("%zu values\n", count);
+    benchmark_fixed("temperatures %.2f", temperatures, count, 2);
+    benchmark_fixed("mantissas %f", mantissas, count, 6);
+    benchmark_shortest("random doubles", doubles, count);
+    benchmark_shortest("temperatures", temperatures, count);
+    benchmark_shortest_float("random floats", floats, count);
+
+    free(temperatures);
+    free(mantissas);
+    free(doubles);
+    free(floats);
+    return EXIT_SUCCESS;
+}
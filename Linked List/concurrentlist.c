@@ -0,0 +1,609 @@
+/*
+ * Program to share one linked list of integers between several threads, in two ways:
+ *
+ * LockedList keeps the positional a/i/r operations of linkedlist3.c and makes them thread safe
+ * with hand-over-hand locking. Every node has its own mutex, and a walk holds at most two of them
+ * at a time, so threads working on different parts of the list do not wait for each other.
+ *
+ * LockFreeList appends to the end and removes by value without any locks, in the style of
+ * Harris's lock-free list: a node is removed by first marking its next pointer, which stops
+ * anything from being linked after it, and then unlinking it with a compare-and-swap. Unlinked
+ * nodes are freed with epoch-based reclamation once no thread can still be reading them.
+ *
+ * Running the program times a mix of operations on both lists for 1, 2, 4, ... threads and
+ * reports throughput for each thread count. Run with -b command_file to replay a file of commands
+ * on the locked list from a single thread instead.
+ * Compile with: gcc -O2 concurrentlist.c list_commands.c -lpthread
+ *
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "list_commands.h"
+
+#define MAX_THREADS 64
+#define DEFAULT_MAX_THREADS 8
+#define DEFAULT_OPERATIONS 20000
+#define INITIAL_LENGTH 1000
+// A thread tries to advance the epoch after retiring this many nodes.
+#define RETIRE_THRESHOLD 64
+#define CACHE_LINE_SIZE 64
+
+/*
+ * A node of the locked list. The mutex protects next.
+ */
+typedef struct Node {
+    int value;
+    struct Node * next;
+    pthread_mutex_t lock;
+} Node;
+
+/*
+ * head is a sentinel holding no value, so that every real node has a predecessor to lock.
+ */
+typedef struct LockedList {
+    Node head;
+    atomic_int length;
+} LockedList;
+
+/*
+ * Returns a Node object allocated on the heap.
+ */
+Node * make_node(int value) {
+    Node * new_node = (Node *)malloc(sizeof(Node));
+    new_node->value = value;
+    new_node->next = NULL;
+    pthread_mutex_init(&new_node->lock, NULL);
+    return new_node;
+}
+
+void make_locked_list(LockedList * list) {
+    list->head.next = NULL;
+    pthread_mutex_init(&list->head.lock, NULL);
+    atomic_init(&list->length, 0);
+}
+
+/*
+ * Inserts a new element into the list with the given value at the position given by index.
+ * If the index reaches beyond the end of the list, appends the new element to the end.
+ * Returns with no locks held.
+ */
+void insert_element(LockedList * list, int value, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    Node * new_node = make_node(value);
+    Node * before = &list->head;
+    pthread_mutex_lock(&before->lock);
+    // Lock the next node before letting go of the current one, so nothing can be unlinked or
+    // inserted between them while this thread walks past.
+    for (int i = 0; i < index && before->next; ++i) {
+        Node * current = before->next;
+        pthread_mutex_lock(&current->lock);
+        pthread_mutex_unlock(&before->lock);
+        before = current;
+    }
+    new_node->next = before->next;
+    before->next = new_node;
+    pthread_mutex_unlock(&before->lock);
+    atomic_fetch_add(&list->length, 1);
+}
+
+/*
+ * Adds a new element with the given value to the end of the list.
+ */
+void add_element(LockedList * list, int value) {
+    insert_element(list, value, atomic_load(&list->length));
+}
+
+/*
+ * Removes an existing node, freeing its memory.
+ * If the index is greater than or equal to the length of the list, removes the last element.
+ */
+void remove_element(LockedList * list, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    Node * before = &list->head;
+    pthread_mutex_lock(&before->lock);
+    Node * current = before->next;
+    // If the list has no nodes inside of it, ignore the remove command.
+    if (!current) {
+        pthread_mutex_unlock(&before->lock);
+        return;
+    }
+    pthread_mutex_lock(&current->lock);
+    for (int i = 0; i < index && current->next; ++i) {
+        Node * next = current->next;
+        pthread_mutex_lock(&next->lock);
+        pthread_mutex_unlock(&before->lock);
+        before = current;
+        current = next;
+    }
+    // Holding both locks means no other thread can be on its way to current.
+    before->next = current->next;
+    pthread_mutex_unlock(&before->lock);
+    pthread_mutex_unlock(&current->lock);
+    pthread_mutex_destroy(&current->lock);
+    free(current);
+    atomic_fetch_sub(&list->length, 1);
+}
+
+/*
+ * Prints a visualization of the list. Must not run alongside other operations.
+ */
+void print_list(LockedList * list) {
+    Node * current = list->head.next;
+    while (current) {
+        printf("%d -> ", current->value);
+        current = current->next;
+    }
+    printf("null\n");
+}
+
+/*
+ * De-allocates heap memory allocated for the Node objects in the list.
+ */
+void free_list(LockedList * list) {
+    Node * head = list->head.next;
+    Node * current;
+    while (head) {
+        current = head;
+        head = head->next;
+        pthread_mutex_destroy(&current->lock);
+        free(current);
+    }
+    list->head.next = NULL;
+    atomic_store(&list->length, 0);
+}
+
+/*
+ * A node of the lock-free list. The lowest bit of next is the deletion mark; nodes are aligned
+ * to at least two bytes, so real pointers never have it set. append_state settles which thread
+ * retires a node that is removed while its appender may still be pointing the tail hint at it.
+ */
+typedef struct LockFreeNode {
+    int value;
+    _Atomic(uintptr_t) next;
+    atomic_int append_state;
+    struct LockFreeNode * retired_next;
+} LockFreeNode;
+
+// Values of append_state.
+#define APPENDING 0
+#define APPENDED 1
+#define RETIRE_PENDING 2
+
+#define MARK ((uintptr_t) 1)
+#define POINTER(link) ((LockFreeNode *) ((link) & ~MARK))
+#define MARKED(link) ((link) & MARK)
+
+/*
+ * Per-thread state for epoch-based reclamation. A thread announces the global epoch it saw while
+ * it is inside an operation. Nodes it unlinks are kept in the list for that epoch and freed once
+ * the global epoch is three ahead, when every thread that could have seen them has finished its
+ * operation.
+ */
+typedef struct ThreadState {
+    // Keep each thread's state on its own cache line.
+    _Alignas(CACHE_LINE_SIZE) atomic_long epoch;
+    atomic_int active;
+    LockFreeNode * retired[3];
+    int retired_count;
+} ThreadState;
+
+typedef struct LockFreeList {
+    LockFreeNode head;
+    _Atomic(LockFreeNode *) tail;
+    atomic_int length;
+    atomic_long global_epoch;
+    int thread_count;
+    ThreadState threads[MAX_THREADS];
+} LockFreeList;
+
+void make_lock_free_list(LockFreeList * list, int thread_count) {
+    atomic_init(&list->head.next, (uintptr_t) 0);
+    atomic_init(&list->tail, &list->head);
+    atomic_init(&list->length, 0);
+    atomic_init(&list->global_epoch, 0);
+    list->thread_count = thread_count;
+    for (int t = 0; t < MAX_THREADS; t++) {
+        atomic_init(&list->threads[t].epoch, 0);
+        atomic_init(&list->threads[t].active, 0);
+        for (int e = 0; e < 3; e++) {
+            list->threads[t].retired[e] = NULL;
+        }
+        list->threads[t].retired_count = 0;
+    }
+}
+
+/*
+ * Free a chain of retired nodes.
+ */
+static void free_retired(LockFreeNode * node) {
+    while (node) {
+        LockFreeNode * next = node->retired_next;
+        free(node);
+        node = next;
+    }
+}
+
+/*
+ * Start an operation on the list. If the global epoch has moved on since this thread's last
+ * operation, the nodes it retired three epochs ago can no longer be reached by anyone.
+ */
+static void enter_epoch(LockFreeList * list, int thread) {
+    ThreadState * state = &list->threads[thread];
+    atomic_store(&state->active, 1);
+    long epoch = atomic_load(&list->global_epoch);
+    if (epoch != atomic_load(&state->epoch)) {
+        free_retired(state->retired[epoch % 3]);
+        state->retired[epoch % 3] = NULL;
+        atomic_store(&state->epoch, epoch);
+    }
+}
+
+static void exit_epoch(LockFreeList * list, int thread) {
+    atomic_store(&list->threads[thread].active, 0);
+}
+
+/*
+ * Advance the global epoch if every thread inside an operation has already seen it.
+ */
+static void try_advance_epoch(LockFreeList * list) {
+    long epoch = atomic_load(&list->global_epoch);
+    for (int t = 0; t < list->thread_count; t++) {
+        ThreadState * state = &list->threads[t];
+        if (atomic_load(&state->active) && atomic_load(&state->epoch) != epoch) {
+            return;
+        }
+    }
+    atomic_compare_exchange_strong(&list->global_epoch, &epoch, epoch + 1);
+}
+
+/*
+ * Put an unlinked node on this thread's list for the current epoch. The tail hint must never be
+ * left pointing at freed memory, so if it points at the node it is first moved back to the head.
+ */
+static void retire_unpublished(LockFreeList * list, int thread, LockFreeNode * node) {
+    LockFreeNode * expected = node;
+    atomic_compare_exchange_strong(&list->tail, &expected, &list->head);
+
+    ThreadState * state = &list->threads[thread];
+    long epoch = atomic_load(&state->epoch);
+    node->retired_next = state->retired[epoch % 3];
+    state->retired[epoch % 3] = node;
+    if (++state->retired_count % RETIRE_THRESHOLD == 0) {
+        try_advance_epoch(list);
+    }
+}
+
+/*
+ * Hand an unlinked node over for freeing. If its appender has not finished with the tail hint,
+ * the appender might still point the hint at the node after it is checked here, where a thread
+ * in a later epoch could pick it up. In that case the appender retires it instead, within its own
+ * epoch, once the hint is settled.
+ */
+static void retire_node(LockFreeList * list, int thread, LockFreeNode * node) {
+    if (atomic_exchange(&node->append_state, RETIRE_PENDING) == APPENDING) {
+        return;
+    }
+    retire_unpublished(list, thread, node);
+}
+
+/*
+ * Returns the last node of the list, starting from the tail hint. Marked nodes met on the way
+ * are unlinked. If the walk reaches a node that is being removed, it starts over from the head,
+ * which is never removed.
+ */
+static LockFreeNode * find_last(LockFreeList * list, int thread) {
+    LockFreeNode * before = atomic_load(&list->tail);
+    for (;;) {
+        uintptr_t link = atomic_load(&before->next);
+        if (MARKED(link)) {
+            before = &list->head;
+            continue;
+        }
+        LockFreeNode * current = POINTER(link);
+        if (!current) {
+            return before;
+        }
+        uintptr_t current_link = atomic_load(&current->next);
+        if (MARKED(current_link)) {
+            // Help the remover: unlink current. Whoever succeeds retires it.
+            uintptr_t expected = link;
+            if (atomic_compare_exchange_strong(&before->next, &expected,
+                                               current_link & ~MARK)) {
+                retire_node(list, thread, current);
+            }
+            continue;
+        }
+        before = current;
+    }
+}
+
+/*
+ * Adds a new element with the given value to the end of the lock-free list.
+ */
+void lock_free_append(LockFreeList * list, int thread, int value) {
+    LockFreeNode * new_node = (LockFreeNode *)malloc(sizeof(LockFreeNode));
+    new_node->value = value;
+    atomic_init(&new_node->next, (uintptr_t) 0);
+    atomic_init(&new_node->append_state, APPENDING);
+
+    enter_epoch(list, thread);
+    LockFreeNode * last;
+    for (;;) {
+        last = find_last(list, thread);
+        uintptr_t expected = 0;
+        if (atomic_compare_exchange_strong(&last->next, &expected, (uintptr_t) new_node)) {
+            break;
+        }
+    }
+    // Only move the hint forward from the node appended to, so that a hint another thread has
+    // since moved, or reset to the head, is never overwritten.
+    atomic_compare_exchange_strong(&list->tail, &last, new_node);
+    // If the new node was removed meanwhile, its remover left retiring it to this thread, which
+    // moves the hint off it first.
+    if (atomic_exchange(&new_node->append_state, APPENDED) == RETIRE_PENDING) {
+        retire_unpublished(list, thread, new_node);
+    }
+    exit_epoch(list, thread);
+    atomic_fetch_add(&list->length, 1);
+}
+
+/*
+ * Removes the first element with the given value from the lock-free list. Returns 1 if one was
+ * removed and 0 if the value was not found.
+ */
+int lock_free_remove(LockFreeList * list, int thread, int value) {
+    enter_epoch(list, thread);
+retry:
+    ;
+    LockFreeNode * before = &list->head;
+    uintptr_t link = atomic_load(&before->next);
+    while (POINTER(link)) {
+        LockFreeNode * current = POINTER(link);
+        uintptr_t current_link = atomic_load(&current->next);
+        if (MARKED(current_link)) {
+            // Another thread is removing current; finish unlinking it and carry on.
+            uintptr_t expected = link;
+            if (!atomic_compare_exchange_strong(&before->next, &expected,
+                                                current_link & ~MARK)) {
+                goto retry;
+            }
+            retire_node(list, thread, current);
+            link = current_link & ~MARK;
+            continue;
+        }
+        if (current->value == value) {
+            // Marking the node is the moment it leaves the list; only one thread can do it.
+            if (!atomic_compare_exchange_strong(&current->next, &current_link,
+                                                current_link | MARK)) {
+                goto retry;
+            }
+            uintptr_t expected = link;
+            if (atomic_compare_exchange_strong(&before->next, &expected, current_link)) {
+                retire_node(list, thread, current);
+            }
+            // Otherwise a later walk will unlink and retire it.
+            exit_epoch(list, thread);
+            atomic_fetch_sub(&list->length, 1);
+            return 1;
+        }
+        before = current;
+        link = current_link;
+    }
+    exit_epoch(list, thread);
+    return 0;
+}
+
+/*
+ * Free every node still in the lock-free list and every retired node. Must not run alongside
+ * other operations.
+ */
+void free_lock_free_list(LockFreeList * list) {
+    LockFreeNode * current = POINTER(atomic_load(&list->head.next));
+    while (current) {
+        LockFreeNode * next = POINTER(atomic_load(&current->next));
+        free(current);
+        current = next;
+    }
+    atomic_store(&list->head.next, (uintptr_t) 0);
+    for (int t = 0; t < MAX_THREADS; t++) {
+        for (int e = 0; e < 3; e++) {
+            free_retired(list->threads[t].retired[e]);
+            list->threads[t].retired[e] = NULL;
+        }
+    }
+}
+
+/*
+ * Count the nodes reachable from the head that are not marked for removal.
+ */
+int count_lock_free_list(LockFreeList * list) {
+    int count = 0;
+    uintptr_t link = atomic_load(&list->head.next);
+    while (POINTER(link)) {
+        link = atomic_load(&POINTER(link)->next);
+        count += !MARKED(link);
+    }
+    return count;
+}
+
+/*
+ * Count the nodes of the locked list. Must not run alongside other operations.
+ */
+int count_locked_list(LockedList * list) {
+    int count = 0;
+    for (Node * current = list->head.next; current; current = current->next) {
+        ++count;
+    }
+    return count;
+}
+
+typedef struct stress_parameters {
+    LockedList * locked_list;
+    LockFreeList * lock_free_list;
+    int thread;
+    int operations;
+    unsigned int seed;
+    long appended;
+    long removed;
+} stress_parameters;
+
+/*
+ * Thread entry point for the locked list: a quarter appends, a quarter inserts at random
+ * positions, and half removes at random positions, so the list keeps about its initial length.
+ */
+void * stress_locked(void * stress_parameters_arg) {
+    stress_parameters * parameters = (stress_parameters *) stress_parameters_arg;
+    LockedList * list = parameters->locked_list;
+    for (int op = 0; op < parameters->operations; op++) {
+        int choice = rand_r(&parameters->seed) % 4;
+        int length = atomic_load(&list->length);
+        int index = rand_r(&parameters->seed) % (length + 1);
+        if (choice == 0) {
+            add_element(list, op);
+            ++parameters->appended;
+        } else if (choice == 1) {
+            insert_element(list, op, index);
+            ++parameters->appended;
+        } else if (length > 0) {
+            remove_element(list, index);
+            ++parameters->removed;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Thread entry point for the lock-free list: append a value this thread owns, then remove one of
+ * its earlier values every other operation, so that removals always find something.
+ */
+void * stress_lock_free(void * stress_parameters_arg) {
+    stress_parameters * parameters = (stress_parameters *) stress_parameters_arg;
+    LockFreeList * list = parameters->lock_free_list;
+    int base = (parameters->thread + 1) * 10000000;
+    int next_removal = 0;
+    for (int op = 0; op < parameters->operations; op++) {
+        if (op % 2 == 0) {
+            lock_free_append(list, parameters->thread, base + op / 2);
+            ++parameters->appended;
+        } else {
+            parameters->removed += lock_free_remove(list, parameters->thread,
+                                                    base + next_removal++);
+        }
+    }
+    return NULL;
+}
+
+static double wall_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Run one stress test with the given number of threads and report its throughput. Returns 1 if
+ * the list ended up with the number of elements the threads' appends and removes add up to.
+ */
+int run_stress(int lock_free, int thread_count, int operations) {
+    LockedList locked_list;
+    LockFreeList * lock_free_list = (LockFreeList *)aligned_alloc(CACHE_LINE_SIZE,
+                                                                  sizeof(LockFreeList));
+    make_locked_list(&locked_list);
+    make_lock_free_list(lock_free_list, thread_count);
+    for (int i = 0; i < INITIAL_LENGTH; i++) {
+        if (lock_free) {
+            lock_free_append(lock_free_list, 0, -1);
+        } else {
+            add_element(&locked_list, i);
+        }
+    }
+
+    pthread_t tids[MAX_THREADS];
+    stress_parameters parameters[MAX_THREADS];
+    double start = wall_time();
+    for (int t = 0; t < thread_count; t++) {
+        parameters[t] = (stress_parameters) {&locked_list, lock_free_list, t, operations,
+                                             (unsigned int) t + 1, 0, 0};
+        pthread_create(&tids[t], NULL, lock_free ? stress_lock_free : stress_locked,
+                       &parameters[t]);
+    }
+    long expected = INITIAL_LENGTH;
+    for (int t = 0; t < thread_count; t++) {
+        pthread_join(tids[t], NULL);
+        expected += parameters[t].appended - parameters[t].removed;
+    }
+    double seconds = wall_time() - start;
+
+    int count = lock_free ? count_lock_free_list(lock_free_list) : count_locked_list(&locked_list);
+    long total = (long) thread_count * operations;
+    printf("%-10s %8i %12ld %13lfs %14.0lf %8s\n", lock_free ? "lock-free" : "locked",
+           thread_count, total, seconds, total / seconds, count == expected ? "OK" : "WRONG");
+
+    free_list(&locked_list);
+    free_lock_free_list(lock_free_list);
+    free(lock_free_list);
+    return count == expected;
+}
+
+/*
+ * Adapters from the batch mode backend interface to the list functions.
+ */
+void backend_add(void * list, int value) {
+    add_element((LockedList *) list, value);
+}
+
+void backend_insert(void * list, int value, int index) {
+    insert_element((LockedList *) list, value, index);
+}
+
+void backend_remove(void * list, int index) {
+    remove_element((LockedList *) list, index);
+}
+
+void backend_print(void * list) {
+    print_list((LockedList *) list);
+}
+
+int main(int argc, char * argv[]) {
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        LockedList list;
+        make_locked_list(&list);
+        list_backend backend = {"concurrentlist", &list, backend_add, backend_insert,
+                                backend_remove, backend_print, NULL, NULL};
+        int status = batch_main(&backend, argc, argv);
+        free_list(&list);
+        return status;
+    }
+    if (argc > 3) {
+        printf("Format: ./concurrentlist [max_threads [operations_per_thread]]\n");
+        return EXIT_FAILURE;
+    }
+    int max_threads = argc > 1 ? atoi(argv[1]) : DEFAULT_MAX_THREADS;
+    int operations = argc > 2 ? atoi(argv[2]) : DEFAULT_OPERATIONS;
+    if (max_threads < 1 || max_threads > MAX_THREADS) {
+        printf("Please input a thread count between 1 and %i\n", MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    int correct = 1;
+    printf("%-10s %8s %12s %14s %14s %8s\n", "list", "threads", "operations", "time",
+           "ops/sec", "check");
+    for (int lock_free = 0; lock_free <= 1; lock_free++) {
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            correct = run_stress(lock_free, threads, operations) && correct;
+        }
+    }
+    return correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,243 @@
+/*
+ * Program to build and represent a doubly linked list of integers. The list tracks its tail, so
+ * appending and removing the last element take constant time, and positional commands walk from
+ * whichever end of the list is closer to the index.
+ * Run with -b command_file to replay a file of commands without the interactive prompt.
+ * Compile with: gcc doublylinkedlist.c list_commands.c
+ *
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "list_commands.h"
+
+#define USAGE "Please enter one of the following commands:\n" \
+    "\ta <int> -- add <int> to the end of the list\n" \
+    "\ti <int> <index> -- insert <int> at position <index>\n" \
+    "\tr <index> -- remove element from position <index>\n" \
+    "\tq -- quit.\n"
+
+typedef struct Node {
+    int value;
+    struct Node * prev;
+    struct Node * next;
+} Node;
+
+typedef struct List {
+    Node * head;
+    Node * tail;
+    int length;
+} List;
+
+/*
+ * Returns a Node object allocated on the heap.
+ */
+Node * make_node(int value) {
+    Node * new_node = (Node *)malloc(sizeof(Node));
+    new_node->value = value;
+    new_node->prev = NULL;
+    new_node->next = NULL;
+    return new_node;
+}
+
+/*
+ * Allocates a new List object on the stack.
+ */
+List make_list() {
+    List new_list;
+    new_list.head = NULL;
+    new_list.tail = NULL;
+    new_list.length = 0;
+    return new_list;
+}
+
+/*
+ * Returns the node at the position given by index, which must be inside the list. Walks forward
+ * from the head or backward from the tail, whichever is closer.
+ */
+Node * find_node(List * list, int index) {
+    Node * current;
+    if (index < list->length / 2) {
+        current = list->head;
+        for (int i = 0; i < index; ++i) {
+            current = current->next;
+        }
+    } else {
+        current = list->tail;
+        for (int i = list->length - 1; i > index; --i) {
+            current = current->prev;
+        }
+    }
+    return current;
+}
+
+/*
+ * Adds a new element with the given value to the end of the list.
+ */
+void add_element(List * list, int value) {
+    Node * new_node = make_node(value);
+    if (! list->tail) {
+        list->head = new_node;
+    } else {
+        new_node->prev = list->tail;
+        list->tail->next = new_node;
+    }
+    list->tail = new_node;
+    ++list->length;
+}
+
+/*
+ * Removes an existing node, freeing its memory.
+ * If the index is greater than or equal to the length of the list, removes the last element.
+ */
+void remove_element(List * list, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    // If the list has no nodes inside of it, ignore the remove command.
+    else if (!list->head) {
+        return;
+    }
+    Node * old_node = index >= list->length ? list->tail : find_node(list, index);
+
+    // Unlink the node from both directions, moving the head or tail if it was at either end.
+    if (old_node->prev) {
+        old_node->prev->next = old_node->next;
+    } else {
+        list->head = old_node->next;
+    }
+    if (old_node->next) {
+        old_node->next->prev = old_node->prev;
+    } else {
+        list->tail = old_node->prev;
+    }
+    free(old_node);
+    --list->length;
+}
+
+/*
+ * Inserts a new element into the list with the given value at the position given by index.
+ * If the index reaches beyond the end of the list, appends the new element to the end.
+ */
+void insert_element(List * list, int value, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    if (index >= list->length) {
+        add_element(list, value);
+        return;
+    }
+    Node * new_node = make_node(value);
+    // Link the new node in front of the node currently at index.
+    Node * rest = find_node(list, index);
+    new_node->prev = rest->prev;
+    new_node->next = rest;
+    if (rest->prev) {
+        rest->prev->next = new_node;
+    } else {
+        list->head = new_node;
+    }
+    rest->prev = new_node;
+    ++list->length;
+}
+
+/*
+ * Prints a visualization of the list.
+ */
+void print_list(List * list) {
+    Node * current = list->head;
+    while (current) {
+        printf("%d -> ", current->value);
+        current = current->next;
+    }
+    printf("null\n");
+}
+
+/*
+ * De-allocates heap memory allocated for the Node objects in the list.
+ */
+void free_list(List * list) {
+    Node * head = list->head;
+    Node * current;
+    while (head) {
+        current = head;
+        head = head->next;
+        free(current);
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->length = 0;
+}
+
+/*
+ * Adapters from the batch mode backend interface to the list functions.
+ */
+void backend_add(void * list, int value) {
+    add_element((List *) list, value);
+}
+
+void backend_insert(void * list, int value, int index) {
+    insert_element((List *) list, value, index);
+}
+
+void backend_remove(void * list, int index) {
+    remove_element((List *) list, index);
+}
+
+void backend_print(void * list) {
+    print_list((List *) list);
+}
+
+/*
+ * Takes user input to build and manipulate the list and print the results.
+ */
+int main(int argc, char * argv[]) {
+    if (argc > 1) {
+        List list = make_list();
+        list_backend backend = {"doublylinkedlist", &list, backend_add, backend_insert,
+                                backend_remove, backend_print, NULL, NULL};
+        int status = batch_main(&backend, argc, argv);
+        free_list(&list);
+        return status;
+    }
+
+    char c;
+    int value;
+    int index;
+    List list = make_list();
+    printf(USAGE);
+    printf("> ");
+    while (scanf("%c", &c) != EOF) {
+        if (c == 'q') {
+            while (getchar() != (int)'\n');
+            break;
+        }
+        switch (c) {
+            case 'a':
+                scanf("%d", &value);
+                add_element(&list, value);
+                print_list(&list);
+                break;
+            case 'i':
+                scanf("%d %d", &value, &index);
+                insert_element(&list, value, index);
+                print_list(&list);
+                break;
+            case 'r':
+                scanf("%d", &index);
+                remove_element(&list, index);
+                print_list(&list);
+                break;
+            default:
+                break;
+        }
+        while (getchar() != (int)'\n');
+        printf("> ");
+    }
+    free_list(&list);
+    return EXIT_SUCCESS;
+}
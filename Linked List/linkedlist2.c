@@ -1,5 +1,7 @@
 /*
  * Program to build and represent a linked list of integers.
+ * Run with -b command_file to replay a file of commands without the interactive prompt.
+ * Compile with: gcc linkedlist2.c list_commands.c
  *
  * Author: Neo Zhou - zhouaea@bc.edu
  */
@@ -7,6 +9,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "list_commands.h"
 
 #define USAGE "Please enter one of the following commands:\n" \
     "\ta <int> -- add <int> to the end of the list\n" \
@@ -164,10 +167,38 @@ void free_list(List * list) {
     list->length = 0;
 }
 
+/*
+ * Adapters from the batch mode backend interface to the list functions.
+ */
+void backend_add(void * list, int value) {
+    add_element((List *) list, value);
+}
+
+void backend_insert(void * list, int value, int index) {
+    insert_element((List *) list, value, index);
+}
+
+void backend_remove(void * list, int index) {
+    remove_element((List *) list, index);
+}
+
+void backend_print(void * list) {
+    print_list((List *) list);
+}
+
 /*
  * Takes user input to build and manipulate the list and print the results.
  */
 int main(int argc, char * argv[]) {
+    if (argc > 1) {
+        List list = make_list();
+        list_backend backend = {"linkedlist2", &list, backend_add, backend_insert,
+                                backend_remove, backend_print, NULL, NULL};
+        int status = batch_main(&backend, argc, argv);
+        free_list(&list);
+        return status;
+    }
+
     char c;
     int value;
     int index;
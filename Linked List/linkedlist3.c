@@ -1,39 +1,132 @@
 /*
  * Program to build and represent a linked list of integers.
+ * Run with -b command_file to replay a file of commands without the interactive prompt, and with
+ * -s snapshot_file first to start from a list saved by the w command.
+ * Compile with: gcc linkedlist3.c list_commands.c
  *
  * Author: Neo Zhou - zhouaea@bc.edu
  */
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "list_commands.h"
 
 #define USAGE "Please enter one of the following commands:\n" \
     "\ta <int> -- add <int> to the end of the list\n" \
     "\ti <int> <index> -- insert <int> at position <index>\n" \
     "\tr <index> -- remove element from position <index>\n" \
+    "\tm -- print node memory statistics\n" \
+    "\tw <file> -- save a snapshot of the list to <file>\n" \
     "\tq -- quit.\n"
 
+// Nodes per slab: one malloc provides this many nodes.
+#define SLAB_NODES 1024
+
+#define SNAPSHOT_MAGIC "LISTSNP1"
+#define SNAPSHOT_MAGIC_LENGTH 8
+#define SNAPSHOT_BUFFER_VALUES 4096
+
 typedef struct Node {
     int value;
     struct Node * next;
 } Node;
 
+/*
+ * A block of nodes allocated with a single malloc. Slabs hold SLAB_NODES nodes, except that a
+ * snapshot is loaded into one slab exactly as large as the list.
+ */
+typedef struct Slab {
+    struct Slab * next;
+    int capacity;
+    Node nodes[];
+} Slab;
+
+/*
+ * The start of a snapshot file, which is followed by length values in list order.
+ */
+typedef struct SnapshotHeader {
+    char magic[SNAPSHOT_MAGIC_LENGTH];
+    int64_t length;
+} SnapshotHeader;
+
+/*
+ * Hands out nodes from slabs. Freed nodes are kept on free_nodes, linked through their next
+ * pointers, and reused before any new slab space is taken.
+ */
+typedef struct NodePool {
+    Slab * slabs;
+    int slab_used;
+    Node * free_nodes;
+    long slab_count;
+    long slab_bytes;
+    long allocations;
+    long reused;
+    long live;
+    long peak_live;
+} NodePool;
+
 typedef struct List {
     Node * head;
     int length;
+    NodePool pool;
 } List;
 
 /*
- * Returns a Node object allocated on the heap.
+ * Allocates a slab with room for capacity nodes and makes it the pool's current slab.
  */
-Node * make_node(int value) {
-    Node * new_node = (Node *)malloc(sizeof(Node));
+Slab * make_slab(NodePool * pool, int capacity) {
+    Slab * slab = (Slab *)malloc(sizeof(Slab) + capacity * sizeof(Node));
+    slab->next = pool->slabs;
+    slab->capacity = capacity;
+    pool->slabs = slab;
+    pool->slab_used = 0;
+    ++pool->slab_count;
+    pool->slab_bytes += sizeof(Slab) + capacity * sizeof(Node);
+    return slab;
+}
+
+/*
+ * Returns a Node object taken from the list's node pool.
+ */
+Node * make_node(List * list, int value) {
+    NodePool * pool = &list->pool;
+    Node * new_node;
+    if (pool->free_nodes) {
+        new_node = pool->free_nodes;
+        pool->free_nodes = new_node->next;
+        ++pool->reused;
+    } else {
+        // Start a new slab once the current one is used up.
+        if (!pool->slabs || pool->slab_used == pool->slabs->capacity) {
+            make_slab(pool, SLAB_NODES);
+        }
+        new_node = &pool->slabs->nodes[pool->slab_used++];
+    }
+    ++pool->allocations;
+    if (++pool->live > pool->peak_live) {
+        pool->peak_live = pool->live;
+    }
     new_node->value = value;
     new_node->next = NULL;
     return new_node;
 }
 
+/*
+ * Returns a node to the list's node pool so that make_node can reuse it.
+ */
+void free_node(List * list, Node * node) {
+    node->next = list->pool.free_nodes;
+    list->pool.free_nodes = node;
+    --list->pool.live;
+}
+
 /*
  * Allocates a new List object on the stack.
  */
@@ -41,6 +134,15 @@ List make_list() {
     List new_list;
     new_list.head = NULL;
     new_list.length = 0;
+    new_list.pool.slabs = NULL;
+    new_list.pool.slab_used = 0;
+    new_list.pool.free_nodes = NULL;
+    new_list.pool.slab_count = 0;
+    new_list.pool.slab_bytes = 0;
+    new_list.pool.allocations = 0;
+    new_list.pool.reused = 0;
+    new_list.pool.live = 0;
+    new_list.pool.peak_live = 0;
     return new_list;
 }
 
@@ -48,7 +150,7 @@ List make_list() {
  * Adds a new element with the given value to the end of the list.
  */
 void add_element(List * list, int value) {
-    Node * new_node = make_node(value);
+    Node * new_node = make_node(list, value);
     if (! list->head) {
         list->head = new_node;
     } else {
@@ -77,7 +179,7 @@ void remove_element(List * list, int index) {
     else if (list->length == 1) {
         Node * old_head = list->head;
         list->head = NULL;
-        free(old_head);
+        free_node(list, old_head);
         
     }
     // If the index is greater than or equal to the length of the array, remove the last element.
@@ -89,12 +191,12 @@ void remove_element(List * list, int index) {
             next = current->next;
         }
         current->next = NULL;
-        free(next);
+        free_node(list, next);
     // Remove the first element.
     } else if (index == 0) {
         Node * old_head = list->head;
         list->head = old_head->next;
-        free(old_head);
+        free_node(list, old_head);
     // Remove an element in between the first and the last element.
     } else {
         Node * before = list->head;
@@ -105,7 +207,7 @@ void remove_element(List * list, int index) {
         }
         Node * after = current->next;
         before->next = after;
-        free(current);
+        free_node(list, current);
     }
     --list->length;
 }
@@ -123,7 +225,7 @@ void insert_element(List * list, int value, int index) {
         add_element(list, value);
         return;
     }
-    Node * new_node = make_node(value);
+    Node * new_node = make_node(list, value);
     if (index == 0) {
         new_node->next = list->head;
         list->head = new_node;
@@ -152,28 +254,179 @@ void print_list(List * list) {
 }
 
 /*
- * De-allocates heap memory allocated for the Node objects in the list.
+ * Prints how many nodes have been allocated and how much memory the node pool holds.
+ */
+void print_memory(List * list) {
+    NodePool * pool = &list->pool;
+    printf("nodes allocated: %ld (%ld reused), live: %ld, peak live: %ld\n",
+           pool->allocations, pool->reused, pool->live, pool->peak_live);
+    printf("slabs: %ld, slab memory: %ld bytes, peak node memory: %ld bytes\n",
+           pool->slab_count, pool->slab_bytes,
+           pool->peak_live * (long) sizeof(Node));
+}
+
+/*
+ * De-allocates heap memory allocated for the Node objects in the list. Every node lives in a
+ * slab, so this frees the slabs without walking the nodes.
  */
 void free_list(List * list) {
-    Node * head = list->head;
-    Node * current;
-    while (head) {
-        current = head;
-        head = head->next;
+    Slab * slab = list->pool.slabs;
+    Slab * current;
+    while (slab) {
+        current = slab;
+        slab = slab->next;
         free(current);
     }
     list->head = NULL;
     list->length = 0;
+    list->pool.slabs = NULL;
+    list->pool.slab_used = 0;
+    list->pool.free_nodes = NULL;
+    list->pool.slab_count = 0;
+    list->pool.slab_bytes = 0;
+    list->pool.live = 0;
+}
+
+/*
+ * Writes the list to path as a snapshot: a header followed by every value in order.
+ * Returns 0 on success and 1 if the file could not be written.
+ */
+int save_snapshot(List * list, const char * path) {
+    FILE * fptr = fopen(path, "wb");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return 1;
+    }
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH);
+    header.length = list->length;
+    fwrite(&header, sizeof(header), 1, fptr);
+
+    // Gather values into a buffer so the file is written in large pieces.
+    int values[SNAPSHOT_BUFFER_VALUES];
+    int count = 0;
+    for (Node * current = list->head; current; current = current->next) {
+        values[count++] = current->value;
+        if (count == SNAPSHOT_BUFFER_VALUES) {
+            fwrite(values, sizeof(int), count, fptr);
+            count = 0;
+        }
+    }
+    fwrite(values, sizeof(int), count, fptr);
+    if (fclose(fptr) != 0) {
+        printf("File could not be written\n");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Replaces the list with the snapshot at path. The file is mapped into memory and read once
+ * front to back, and all of its nodes are carved out of a single slab, instead of allocating and
+ * appending one node at a time. Returns 0 on success and 1 if the file is not a valid snapshot.
+ */
+int load_snapshot(List * list, const char * path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("File could not be opened\n");
+        return 1;
+    }
+    struct stat file_stat;
+    fstat(fd, &file_stat);
+    size_t size = (size_t) file_stat.st_size;
+    SnapshotHeader * header = NULL;
+    if (size >= sizeof(SnapshotHeader)) {
+        header = (SnapshotHeader *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (header == NULL || header == MAP_FAILED ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LENGTH) != 0 ||
+        header->length < 0 || header->length > INT32_MAX ||
+        size != sizeof(SnapshotHeader) + header->length * sizeof(int)) {
+        printf("%s is not a list snapshot\n", path);
+        if (header != NULL && header != MAP_FAILED) {
+            munmap(header, size);
+        }
+        return 1;
+    }
+    madvise(header, size, MADV_SEQUENTIAL);
+
+    free_list(list);
+    int length = (int) header->length;
+    int * values = (int *) (header + 1);
+    if (length > 0) {
+        Slab * slab = make_slab(&list->pool, length);
+        for (int i = 0; i < length; ++i) {
+            slab->nodes[i].value = values[i];
+            slab->nodes[i].next = i + 1 < length ? &slab->nodes[i + 1] : NULL;
+        }
+        slab->next = NULL;
+        list->pool.slab_used = length;
+        list->head = &slab->nodes[0];
+    }
+    list->length = length;
+    list->pool.allocations += length;
+    list->pool.live = length;
+    if (list->pool.live > list->pool.peak_live) {
+        list->pool.peak_live = list->pool.live;
+    }
+    munmap(header, size);
+    return 0;
+}
+
+/*
+ * Adapters from the batch mode backend interface to the list functions.
+ */
+void backend_add(void * list, int value) {
+    add_element((List *) list, value);
+}
+
+void backend_insert(void * list, int value, int index) {
+    insert_element((List *) list, value, index);
+}
+
+void backend_remove(void * list, int index) {
+    remove_element((List *) list, index);
+}
+
+void backend_print(void * list) {
+    print_list((List *) list);
+}
+
+void backend_memory(void * list) {
+    print_memory((List *) list);
+}
+
+int backend_save(void * list, const char * path) {
+    return save_snapshot((List *) list, path);
 }
 
 /*
  * Takes user input to build and manipulate the list and print the results.
  */
 int main(int argc, char * argv[]) {
+    List list = make_list();
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        if (load_snapshot(&list, argv[2]) != 0) {
+            return EXIT_FAILURE;
+        }
+        // Hide the snapshot option from the batch mode arguments.
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc > 1) {
+        list_backend backend = {"linkedlist3", &list, backend_add, backend_insert,
+                                backend_remove, backend_print, backend_memory, backend_save};
+        int status = batch_main(&backend, argc, argv);
+        free_list(&list);
+        return status;
+    }
+
     char c;
     int value;
     int index;
-    List list = make_list();
+    char path[MAX_PATH_LENGTH];
     printf(USAGE);
     printf("> ");
     while (scanf("%c", &c) != EOF) {
@@ -196,6 +449,15 @@ int main(int argc, char * argv[]) {
                 scanf("%d", &index);
                 remove_element(&list, index);
                 print_list(&list);
+                break;
+            case 'm':
+                print_memory(&list);
+                break;
+            case 'w':
+                if (scanf("%255s", path) == 1) {
+                    save_snapshot(&list, path);
+                }
+                break;
             default:
                 break;
         }
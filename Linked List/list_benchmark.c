@@ -0,0 +1,216 @@
+/*
+ * Program to compare the linked list programs on command files made by list_workload. Every
+ * program is replayed in batch mode on every command file, once to measure throughput and peak
+ * resident memory and once more with -l to collect latency percentiles, since timing each
+ * operation slows the replay down. The second replay also prints the final list, and every
+ * program's final list is checked against the first program's for the same command file.
+ * Compile with: gcc list_benchmark.c
+ *
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define MAX_WORKLOADS 64
+#define OUTPUT_BUFFER_SIZE 4096
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/*
+ * What one replay of a command file reported.
+ */
+typedef struct run_result {
+    long operations;
+    double seconds;
+    double ops_per_second;
+    long p50;
+    long p90;
+    long p99;
+    long p999;
+    long max;
+    long peak_rss_kb;
+    int has_list;
+    uint64_t list_hash;
+} run_result;
+
+/*
+ * Read one complete line of a program's output into result. The summary and latency lines are
+ * parsed, and any other line before the summary is taken as the list, so that the one printed
+ * last is the final list. Lists can be far longer than line, which only holds the start of each
+ * line, so they are compared by line_hash, a hash of the whole line.
+ */
+void parse_line(const char * line, uint64_t line_hash, run_result * result, int * summary_lines,
+                int * latency_lines) {
+    if (strstr(line, " operations in ")) {
+        if (sscanf(line, "%*[^:]: %ld operations in %lf seconds, %lf ops/sec",
+                   &result->operations, &result->seconds, &result->ops_per_second) == 3) {
+            ++*summary_lines;
+        }
+    } else if (strncmp(line, "latency: ", strlen("latency: ")) == 0) {
+        if (sscanf(line, "latency: p50 %ld ns, p90 %ld ns, p99 %ld ns, p99.9 %ld ns, max %ld ns",
+                   &result->p50, &result->p90, &result->p99, &result->p999,
+                   &result->max) == 5) {
+            ++*latency_lines;
+        }
+    } else if (*summary_lines == 0) {
+        result->has_list = 1;
+        result->list_hash = line_hash;
+    }
+}
+
+/*
+ * Runs program -b command_file -n, or program -b command_file -l to also print the final list if
+ * record_latency is set, and parses what it prints into result. Returns 0 on success and -1 if
+ * the program could not be run or failed.
+ */
+int run_program(const char * program, const char * command_file, int record_latency,
+                run_result * result) {
+    int pipe_ends[2];
+    if (pipe(pipe_ends) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(pipe_ends[0]);
+        close(pipe_ends[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(pipe_ends[1], STDOUT_FILENO);
+        close(pipe_ends[0]);
+        close(pipe_ends[1]);
+        if (record_latency) {
+            execl(program, program, "-b", command_file, "-l", (char *) NULL);
+        } else {
+            execl(program, program, "-b", command_file, "-n", (char *) NULL);
+        }
+        perror(program);
+        _exit(127);
+    }
+    close(pipe_ends[1]);
+
+    // Lines are parsed as they arrive, since the final list can be larger than any buffer.
+    char line[OUTPUT_BUFFER_SIZE];
+    size_t line_length = 0;
+    uint64_t line_hash = FNV_OFFSET;
+    char chunk[OUTPUT_BUFFER_SIZE];
+    ssize_t count;
+    int summary_lines = 0;
+    int latency_lines = 0;
+    result->has_list = 0;
+    while ((count = read(pipe_ends[0], chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < count; i++) {
+            if (chunk[i] != '\n') {
+                if (line_length < sizeof(line) - 1) {
+                    line[line_length++] = chunk[i];
+                }
+                line_hash = (line_hash ^ (unsigned char) chunk[i]) * FNV_PRIME;
+                continue;
+            }
+            line[line_length] = '\0';
+            parse_line(line, line_hash, result, &summary_lines, &latency_lines);
+            line_length = 0;
+            line_hash = FNV_OFFSET;
+        }
+    }
+    close(pipe_ends[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) == -1 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        printf("%s failed on %s\n", program, command_file);
+        return -1;
+    }
+    // On Linux, ru_maxrss is in kilobytes.
+    result->peak_rss_kb = usage.ru_maxrss;
+
+    if (summary_lines == 0) {
+        printf("Could not read the summary of %s on %s\n", program, command_file);
+        return -1;
+    }
+    if (record_latency && latency_lines == 0) {
+        printf("Could not read the latencies of %s on %s\n", program, command_file);
+        return -1;
+    }
+    if (record_latency && !result->has_list) {
+        printf("Could not read the final list of %s on %s\n", program, command_file);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Returns the last component of path, which is how programs are named in the table.
+ */
+const char * base_name(const char * path) {
+    const char * slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+int main(int argc, char * argv[]) {
+    const char * command_files[MAX_WORKLOADS];
+    int workload_count = 0;
+    int option;
+    while ((option = getopt(argc, argv, "w:")) != -1) {
+        if (option == 'w' && workload_count < MAX_WORKLOADS) {
+            command_files[workload_count++] = optarg;
+        } else {
+            workload_count = 0;
+            break;
+        }
+    }
+    if (workload_count == 0 || optind == argc) {
+        printf("Format: ./list_benchmark -w command_file [-w command_file]... program...\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-20s %-24s %12s %14s %10s %10s %10s %10s %12s %10s %9s\n", "program", "workload",
+           "operations", "ops/sec", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns",
+           "peak KB", "check");
+    fflush(stdout);
+    int failures = 0;
+    int mismatches = 0;
+    for (int w = 0; w < workload_count; w++) {
+        // The first program to replay a command file gives the final list the rest must match.
+        const char * reference = NULL;
+        uint64_t reference_hash = 0;
+        for (int p = optind; p < argc; p++) {
+            run_result throughput;
+            run_result latency;
+            if (run_program(argv[p], command_files[w], 0, &throughput) != 0 ||
+                run_program(argv[p], command_files[w], 1, &latency) != 0) {
+                ++failures;
+                continue;
+            }
+            const char * check = "reference";
+            if (reference == NULL) {
+                reference = argv[p];
+                reference_hash = latency.list_hash;
+            } else if (latency.list_hash == reference_hash) {
+                check = "OK";
+            } else {
+                check = "WRONG";
+                ++mismatches;
+            }
+            printf("%-20s %-24s %12ld %14.0lf %10ld %10ld %10ld %10ld %12ld %10ld %9s\n",
+                   base_name(argv[p]), base_name(command_files[w]), throughput.operations,
+                   throughput.ops_per_second, latency.p50, latency.p90, latency.p99,
+                   latency.p999, latency.max, throughput.peak_rss_kb, check);
+            if (strcmp(check, "WRONG") == 0) {
+                printf("%s and %s disagree on the final list of %s\n", base_name(argv[p]),
+                       base_name(reference), base_name(command_files[w]));
+            }
+            fflush(stdout);
+        }
+    }
+    return failures == 0 && mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
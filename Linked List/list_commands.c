@@ -0,0 +1,426 @@
+/*
+ * Batch replay of list commands from a file. Commands are parsed straight out of a large read
+ * buffer instead of with scanf, and the list is only printed when a p command asks for it or at
+ * the end, so replaying a long log is bound by the list operations rather than by I/O.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "list_commands.h"
+
+#define READ_BUFFER_SIZE (1 << 20)
+// Latencies are kept in a histogram with 16 buckets per power of two, so percentiles are
+// accurate to within about 6% however many operations are replayed.
+#define LATENCY_SUB_BUCKETS 16
+#define LATENCY_BUCKETS (64 * LATENCY_SUB_BUCKETS)
+
+struct command_reader {
+    FILE * fptr;
+    int binary;
+    long line;
+    size_t position;
+    size_t end;
+    unsigned char buffer[READ_BUFFER_SIZE];
+};
+
+/*
+ * Returns the next byte of the file, refilling the buffer when it runs out, or EOF at the end.
+ */
+static int next_byte(command_reader * reader) {
+    if (reader->position == reader->end) {
+        reader->end = fread(reader->buffer, 1, READ_BUFFER_SIZE, reader->fptr);
+        reader->position = 0;
+        if (reader->end == 0) {
+            return EOF;
+        }
+    }
+    return reader->buffer[reader->position++];
+}
+
+/*
+ * Returns the next byte of the file without consuming it.
+ */
+static int peek_byte(command_reader * reader) {
+    int c = next_byte(reader);
+    if (c != EOF) {
+        --reader->position;
+    }
+    return c;
+}
+
+/*
+ * Open a command file and detect its format from the first bytes. Returns NULL if the file can
+ * not be opened.
+ */
+command_reader * command_reader_open(const char * path) {
+    FILE * fptr = fopen(path, "rb");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return NULL;
+    }
+    command_reader * reader = (command_reader *) malloc(sizeof(command_reader));
+    reader->fptr = fptr;
+    reader->line = 1;
+    reader->position = 0;
+    reader->end = fread(reader->buffer, 1, READ_BUFFER_SIZE, fptr);
+    reader->binary = reader->end >= BINARY_COMMAND_MAGIC_LENGTH &&
+                     memcmp(reader->buffer, BINARY_COMMAND_MAGIC, BINARY_COMMAND_MAGIC_LENGTH) == 0;
+    if (reader->binary) {
+        reader->position = BINARY_COMMAND_MAGIC_LENGTH;
+    }
+    return reader;
+}
+
+void command_reader_close(command_reader * reader) {
+    fclose(reader->fptr);
+    free(reader);
+}
+
+/*
+ * Parse an optionally negative decimal integer after any spaces or tabs. Returns 0 on success and
+ * -1 if there is no number or it does not fit in an int.
+ */
+static int read_text_int(command_reader * reader, int * result) {
+    int c = next_byte(reader);
+    while (c == ' ' || c == '\t') {
+        c = next_byte(reader);
+    }
+    int negative = c == '-';
+    if (negative) {
+        c = next_byte(reader);
+    }
+    if (c < '0' || c > '9') {
+        if (c != EOF) {
+            --reader->position;
+        }
+        return -1;
+    }
+    // Stop as soon as the number no longer fits in an int, which may be INT_MIN when negative.
+    long long limit = negative ? -(long long) INT_MIN : INT_MAX;
+    long long value = 0;
+    while (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        if (value > limit) {
+            return -1;
+        }
+        c = next_byte(reader);
+    }
+    if (c != EOF) {
+        --reader->position;
+    }
+    *result = (int) (negative ? -value : value);
+    return 0;
+}
+
+/*
+ * Read a 32-bit integer in native byte order from a binary command file.
+ */
+static int read_binary_int(command_reader * reader, int * result) {
+    unsigned char bytes[sizeof(int)];
+    for (size_t b = 0; b < sizeof(int); b++) {
+        int c = next_byte(reader);
+        if (c == EOF) {
+            return -1;
+        }
+        bytes[b] = (unsigned char) c;
+    }
+    memcpy(result, bytes, sizeof(int));
+    return 0;
+}
+
+/*
+ * Read a file path into path: the rest of the word in a text file, or a string ending in a zero
+ * byte in a binary file. Returns 0 on success and -1 if there is no path or it is too long.
+ */
+static int read_path(command_reader * reader, char * path) {
+    int c = next_byte(reader);
+    while (!reader->binary && (c == ' ' || c == '\t')) {
+        c = next_byte(reader);
+    }
+    int length = 0;
+    while (c != EOF && (reader->binary ? c != '\0' : c != ' ' && c != '\t' && c != '\r' &&
+                                                     c != '\n')) {
+        if (length == MAX_PATH_LENGTH - 1) {
+            return -1;
+        }
+        path[length++] = (char) c;
+        c = next_byte(reader);
+    }
+    if (!reader->binary && c != EOF) {
+        --reader->position;
+    }
+    path[length] = '\0';
+    return length > 0 ? 0 : -1;
+}
+
+/*
+ * Read the next command into command. Returns 1 when a command was read, 0 at the end of the
+ * file, and -1 if the file is malformed. Unknown command letters in a text file are skipped along
+ * with the rest of their line, as they are at the interactive prompt.
+ */
+int read_command(command_reader * reader, list_command * command) {
+    int (*read_int)(command_reader *, int *) = reader->binary ? read_binary_int : read_text_int;
+    for (;;) {
+        int c = next_byte(reader);
+        if (c == EOF) {
+            return 0;
+        }
+        if (!reader->binary && (c == ' ' || c == '\t' || c == '\r' || c == '\n')) {
+            reader->line += c == '\n';
+            continue;
+        }
+
+        command->type = (char) c;
+        int status = 0;
+        switch (c) {
+            case 'a':
+                status = read_int(reader, &command->value);
+                break;
+            case 'i':
+                status = read_int(reader, &command->value);
+                status = status || read_int(reader, &command->index);
+                break;
+            case 'r':
+                status = read_int(reader, &command->index);
+                break;
+            case 'w':
+                status = read_path(reader, command->path);
+                break;
+            case 'p':
+            case 'm':
+            case 'q':
+                break;
+            default:
+                status = reader->binary ? -1 : 1;
+                break;
+        }
+        if (status < 0) {
+            printf("Malformed command file at %s %ld\n", reader->binary ? "command" : "line",
+                   reader->line);
+            return -1;
+        }
+        if (!reader->binary) {
+            // Skip the rest of the line.
+            while ((c = peek_byte(reader)) != EOF && c != '\n') {
+                next_byte(reader);
+            }
+        } else {
+            ++reader->line;
+        }
+        if (status == 0) {
+            return 1;
+        }
+    }
+}
+
+/*
+ * Start a command file. Binary files need the magic bytes up front; text files need nothing.
+ */
+void write_command_header(FILE * fptr, int binary) {
+    if (binary) {
+        fwrite(BINARY_COMMAND_MAGIC, 1, BINARY_COMMAND_MAGIC_LENGTH, fptr);
+    }
+}
+
+/*
+ * Append one command to a command file, as a line of text or as its letter followed by its
+ * arguments as 32-bit integers, or for w, its path and a zero byte.
+ */
+void write_command(FILE * fptr, list_command * command, int binary) {
+    if (!binary) {
+        switch (command->type) {
+            case 'a':
+                fprintf(fptr, "a %d\n", command->value);
+                break;
+            case 'i':
+                fprintf(fptr, "i %d %d\n", command->value, command->index);
+                break;
+            case 'r':
+                fprintf(fptr, "r %d\n", command->index);
+                break;
+            case 'w':
+                fprintf(fptr, "w %s\n", command->path);
+                break;
+            default:
+                fprintf(fptr, "%c\n", command->type);
+                break;
+        }
+        return;
+    }
+    fputc(command->type, fptr);
+    if (command->type == 'a' || command->type == 'i') {
+        fwrite(&command->value, sizeof(int), 1, fptr);
+    }
+    if (command->type == 'i' || command->type == 'r') {
+        fwrite(&command->index, sizeof(int), 1, fptr);
+    }
+    if (command->type == 'w') {
+        fwrite(command->path, 1, strlen(command->path) + 1, fptr);
+    }
+}
+
+static double wall_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static long wall_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/*
+ * Returns the histogram bucket for a latency: values under 16ns get a bucket each, and every
+ * larger power of two is split into LATENCY_SUB_BUCKETS equal parts.
+ */
+static int latency_bucket(long ns) {
+    if (ns < LATENCY_SUB_BUCKETS) {
+        return ns < 0 ? 0 : (int) ns;
+    }
+    int exponent = 63 - __builtin_clzl((unsigned long) ns);
+    int sub_bucket = (int) ((ns >> (exponent - 4)) & (LATENCY_SUB_BUCKETS - 1));
+    return (exponent - 3) * LATENCY_SUB_BUCKETS + sub_bucket;
+}
+
+/*
+ * Returns the smallest latency that falls into a bucket.
+ */
+static long bucket_latency(int bucket) {
+    if (bucket < 2 * LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int exponent = bucket / LATENCY_SUB_BUCKETS + 3;
+    return (long) (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << (exponent - 4);
+}
+
+/*
+ * Returns the latency below which the given fraction of the recorded operations fall.
+ */
+static long latency_percentile(long * histogram, long count, double fraction) {
+    long target = (long) (fraction * count);
+    long seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += histogram[bucket];
+        if (seen > target) {
+            return bucket_latency(bucket);
+        }
+    }
+    return bucket_latency(LATENCY_BUCKETS - 1);
+}
+
+/*
+ * Apply every command in the file at path to the backend's list. The list is printed for each p
+ * command and, if print_at_end is set, once after the last command. Reports the number of list
+ * operations and their rate, and with record_latency set, percentiles of the time each operation
+ * took. Timing every operation adds a little to each, so rates are best measured without it.
+ * Returns 0 on success and 1 if the file could not be replayed.
+ */
+int run_batch(list_backend * backend, const char * path, int print_at_end, int record_latency) {
+    command_reader * reader = command_reader_open(path);
+    if (reader == NULL) {
+        return 1;
+    }
+
+    list_command command;
+    long operations = 0;
+    long * histogram = record_latency ? (long *) calloc(LATENCY_BUCKETS, sizeof(long)) : NULL;
+    long max_latency = 0;
+    long operation_start = 0;
+    int status;
+    double start = wall_time();
+    while ((status = read_command(reader, &command)) == 1 && command.type != 'q') {
+        if (record_latency) {
+            operation_start = wall_time_ns();
+        }
+        switch (command.type) {
+            case 'a':
+                backend->add(backend->list, command.value);
+                ++operations;
+                break;
+            case 'i':
+                backend->insert(backend->list, command.value, command.index);
+                ++operations;
+                break;
+            case 'r':
+                backend->remove(backend->list, command.index);
+                ++operations;
+                break;
+            case 'p':
+                backend->print(backend->list);
+                break;
+            case 'm':
+                if (backend->memory) {
+                    backend->memory(backend->list);
+                }
+                break;
+            case 'w':
+                if (backend->save) {
+                    backend->save(backend->list, command.path);
+                }
+                break;
+        }
+        if (record_latency && (command.type == 'a' || command.type == 'i' ||
+                               command.type == 'r')) {
+            long latency = wall_time_ns() - operation_start;
+            ++histogram[latency_bucket(latency)];
+            if (latency > max_latency) {
+                max_latency = latency;
+            }
+        }
+    }
+    double seconds = wall_time() - start;
+    command_reader_close(reader);
+    if (status < 0) {
+        free(histogram);
+        return 1;
+    }
+
+    if (print_at_end) {
+        backend->print(backend->list);
+    }
+    printf("%s: %ld operations in %lf seconds, %.0lf ops/sec\n", backend->name, operations,
+           seconds, seconds > 0 ? operations / seconds : 0.0);
+    if (record_latency) {
+        printf("latency: p50 %ld ns, p90 %ld ns, p99 %ld ns, p99.9 %ld ns, max %ld ns\n",
+               latency_percentile(histogram, operations, 0.5),
+               latency_percentile(histogram, operations, 0.9),
+               latency_percentile(histogram, operations, 0.99),
+               latency_percentile(histogram, operations, 0.999), max_latency);
+        free(histogram);
+    }
+    return 0;
+}
+
+/*
+ * Handle the batch mode command line, -b command_file [-n] [-l], where -n skips printing the
+ * final list and -l reports latency percentiles. Returns the program's exit status.
+ */
+int batch_main(list_backend * backend, int argc, char * argv[]) {
+    int print_at_end = 1;
+    int record_latency = 0;
+    char * path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0) {
+            print_at_end = 0;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            record_latency = 1;
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        printf("Format: %s [-b command_file [-n] [-l]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    return run_batch(backend, path, print_at_end, record_latency) == 0 ? EXIT_SUCCESS
+                                                                        : EXIT_FAILURE;
+}
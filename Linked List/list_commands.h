@@ -0,0 +1,59 @@
+/*
+ * Batch replay of list commands from a file, shared by the linked list programs. A command file
+ * is either text, one command per line in the same form typed at the interactive prompt, or the
+ * compact binary encoding written by write_command.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#ifndef LIST_COMMANDS_H
+#define LIST_COMMANDS_H
+
+#include <stdio.h>
+
+// Binary command files start with this, so that either format can be given to -b.
+#define BINARY_COMMAND_MAGIC "LISTCMD1"
+#define BINARY_COMMAND_MAGIC_LENGTH 8
+#define MAX_PATH_LENGTH 256
+
+/*
+ * One command. type is the command letter: 'a', 'i', 'r', 'p' to print the list, 'm' to print
+ * memory statistics, 'w' to save a snapshot to path, or 'q'. value, index, and path are only
+ * meaningful for the commands that take them.
+ */
+typedef struct list_command {
+    char type;
+    int value;
+    int index;
+    char path[MAX_PATH_LENGTH];
+} list_command;
+
+/*
+ * The operations batch mode needs from a list implementation. list is passed back to every
+ * function. memory may be NULL for lists that keep no allocation statistics, and save may be NULL
+ * for lists that can not be saved as snapshots.
+ */
+typedef struct list_backend {
+    const char * name;
+    void * list;
+    void (*add)(void * list, int value);
+    void (*insert)(void * list, int value, int index);
+    void (*remove)(void * list, int index);
+    void (*print)(void * list);
+    void (*memory)(void * list);
+    int (*save)(void * list, const char * path);
+} list_backend;
+
+// Define the command_reader struct in list_commands.c so callers can not access it.
+typedef struct command_reader command_reader;
+
+command_reader * command_reader_open(const char * path);
+int read_command(command_reader * reader, list_command * command);
+void command_reader_close(command_reader * reader);
+
+void write_command_header(FILE * fptr, int binary);
+void write_command(FILE * fptr, list_command * command, int binary);
+
+int run_batch(list_backend * backend, const char * path, int print_at_end, int record_latency);
+int batch_main(list_backend * backend, int argc, char * argv[]);
+
+#endif
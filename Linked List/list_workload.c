@@ -0,0 +1,139 @@
+/*
+ * Program to generate command files for benchmarking the linked lists in batch mode.
+ * Workloads:
+ *     append -- mostly appends, with a few inserts and removes at random positions
+ *     insert -- inserts at random positions
+ *     front-remove -- removes from the front of the list
+ *     mixed -- appends, inserts, and removes in equal parts
+ * Every workload starts by appending initial_length elements so that positional commands have
+ * something to work on. With a skew above 0, positions are drawn closer to the front of the list.
+ * Files are written in the binary encoding unless -t asks for text.
+ * Compile with: gcc list_workload.c list_commands.c -lm
+ *
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "list_commands.h"
+
+#define DEFAULT_INITIAL_LENGTH 10000
+
+/*
+ * Percentages of appends and inserts in a workload; the rest are removes.
+ */
+typedef struct workload {
+    const char * name;
+    int append_percent;
+    int insert_percent;
+    int front_only;
+} workload;
+
+const workload workloads[] = {
+    {"append", 90, 5, 0},
+    {"insert", 0, 100, 0},
+    {"front-remove", 0, 0, 1},
+    {"mixed", 34, 33, 0},
+};
+
+const int workload_count = sizeof(workloads) / sizeof(workload);
+
+/*
+ * Returns a position from 0 up to limit - 1. u^(1 + skew) is uniform for skew 0 and piles up
+ * near 0 as skew grows.
+ */
+int random_position(int limit, double skew) {
+    if (limit <= 0) {
+        return 0;
+    }
+    double u = (double) rand() / ((double) RAND_MAX + 1);
+    int position = (int) (limit * pow(u, 1 + skew));
+    return position < limit ? position : limit - 1;
+}
+
+/*
+ * Write the initial appends and then operations commands of the workload to fptr.
+ */
+void generate(const workload * kind, int operations, int initial_length, double skew,
+              FILE * fptr, int binary) {
+    list_command command;
+    int length = 0;
+    write_command_header(fptr, binary);
+    for (int i = 0; i < initial_length; i++) {
+        command = (list_command) {'a', rand(), 0, ""};
+        write_command(fptr, &command, binary);
+        ++length;
+    }
+
+    for (int op = 0; op < operations; op++) {
+        int choice = rand() % 100;
+        if (kind->front_only) {
+            // Refill once the list runs dry so that removes keep having something to remove.
+            command = length > 0 ? (list_command) {'r', 0, 0, ""}
+                                 : (list_command) {'a', rand(), 0, ""};
+        } else if (choice < kind->append_percent) {
+            command = (list_command) {'a', rand(), 0, ""};
+        } else if (choice < kind->append_percent + kind->insert_percent || length == 0) {
+            command = (list_command) {'i', rand(), random_position(length + 1, skew), ""};
+        } else {
+            command = (list_command) {'r', 0, random_position(length, skew), ""};
+        }
+        length += command.type == 'r' ? -1 : 1;
+        write_command(fptr, &command, binary);
+    }
+}
+
+int main(int argc, char * argv[]) {
+    int binary = 1;
+    int initial_length = DEFAULT_INITIAL_LENGTH;
+    double skew = 0;
+    unsigned int seed = 1;
+    int option;
+    while ((option = getopt(argc, argv, "ti:s:r:")) != -1) {
+        switch (option) {
+            case 't':
+                binary = 0;
+                break;
+            case 'i':
+                initial_length = atoi(optarg);
+                break;
+            case 's':
+                skew = atof(optarg);
+                break;
+            case 'r':
+                seed = (unsigned int) atoi(optarg);
+                break;
+            default:
+                argc = 0;
+                break;
+        }
+    }
+
+    const workload * kind = NULL;
+    if (argc - optind == 3) {
+        for (int w = 0; w < workload_count; w++) {
+            if (strcmp(argv[optind], workloads[w].name) == 0) {
+                kind = &workloads[w];
+            }
+        }
+    }
+    int operations = kind ? atoi(argv[optind + 1]) : 0;
+    if (kind == NULL || operations < 0 || initial_length < 0 || skew < 0) {
+        printf("Format: ./list_workload [-t] [-i initial_length] [-s skew] [-r seed] "
+               "append|insert|front-remove|mixed operations output_file\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE * fptr = fopen(argv[optind + 2], "wb");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return EXIT_FAILURE;
+    }
+    srand(seed);
+    generate(kind, operations, initial_length, skew, fptr, binary);
+    fclose(fptr);
+    return EXIT_SUCCESS;
+}
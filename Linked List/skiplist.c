@@ -0,0 +1,317 @@
+/*
+ * Program to build and represent a linked list of integers, indexed by a skip list so that
+ * positional inserts, removes, and lookups take O(log n) steps instead of walking from the head.
+ * Run with -b command_file to replay a file of commands without the interactive prompt.
+ * Compile with: gcc skiplist.c list_commands.c
+ *
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "list_commands.h"
+
+#define USAGE "Please enter one of the following commands:\n" \
+    "\ta <int> -- add <int> to the end of the list\n" \
+    "\ti <int> <index> -- insert <int> at position <index>\n" \
+    "\tr <index> -- remove element from position <index>\n" \
+    "\tg <index> -- print the element at position <index>\n" \
+    "\tq -- quit.\n"
+
+#define MAX_LEVEL 32
+
+/*
+ * One forward pointer of a node. width is how many positions following next advances, so the
+ * position of any node is the sum of the widths on the path that reaches it.
+ */
+typedef struct Link {
+    struct Node * next;
+    int width;
+} Link;
+
+/*
+ * A node is on levels 0 up to level - 1. Level 0 links every node in order, like the plain list.
+ */
+typedef struct Node {
+    int value;
+    int level;
+    Link links[];
+} Node;
+
+/*
+ * head is a sentinel on every level at position -1, which holds no value.
+ */
+typedef struct List {
+    Node * head;
+    int length;
+    int level;
+} List;
+
+/*
+ * Returns a Node object allocated on the heap with room for level links.
+ */
+Node * make_node(int value, int level) {
+    Node * new_node = (Node *)malloc(sizeof(Node) + level * sizeof(Link));
+    new_node->value = value;
+    new_node->level = level;
+    for (int l = 0; l < level; ++l) {
+        new_node->links[l].next = NULL;
+        new_node->links[l].width = 0;
+    }
+    return new_node;
+}
+
+/*
+ * Allocates a new List object on the stack, with its sentinel head on the heap.
+ */
+List make_list() {
+    List new_list;
+    new_list.head = make_node(0, MAX_LEVEL);
+    new_list.length = 0;
+    new_list.level = 1;
+    return new_list;
+}
+
+/*
+ * Picks the number of levels for a new node: each extra level is kept with probability 1/4, so
+ * every level has about a quarter of the nodes of the level below.
+ */
+int random_level() {
+    int level = 1;
+    while (level < MAX_LEVEL && (rand() & 3) == 0) {
+        ++level;
+    }
+    return level;
+}
+
+/*
+ * Finds, on every level, the last node before position index and stores it in before along with
+ * its position in before_position.
+ */
+void find_predecessors(List * list, int index, Node ** before, int * before_position) {
+    Node * current = list->head;
+    int position = -1;
+    for (int l = list->level - 1; l >= 0; --l) {
+        while (current->links[l].next && position + current->links[l].width < index) {
+            position += current->links[l].width;
+            current = current->links[l].next;
+        }
+        before[l] = current;
+        before_position[l] = position;
+    }
+}
+
+/*
+ * Inserts a new element into the list with the given value at the position given by index.
+ * If the index reaches beyond the end of the list, appends the new element to the end.
+ */
+void insert_element(List * list, int value, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    if (index > list->length) {
+        index = list->length;
+    }
+
+    Node * before[MAX_LEVEL];
+    int before_position[MAX_LEVEL];
+    int level = random_level();
+    // New levels start out with only the head on them.
+    for (int l = list->level; l < level; ++l) {
+        list->head->links[l].next = NULL;
+    }
+    if (level > list->level) {
+        list->level = level;
+    }
+    find_predecessors(list, index, before, before_position);
+
+    Node * new_node = make_node(value, level);
+    for (int l = 0; l < list->level; ++l) {
+        Link * link = &before[l]->links[l];
+        if (l < level) {
+            // Split the link: the new node now covers the rest of the old width plus itself.
+            new_node->links[l].next = link->next;
+            new_node->links[l].width = before_position[l] + link->width + 1 - index;
+            link->next = new_node;
+            link->width = index - before_position[l];
+        } else if (link->next) {
+            // Links above the new node jump over one more position.
+            ++link->width;
+        }
+    }
+    ++list->length;
+}
+
+/*
+ * Adds a new element with the given value to the end of the list.
+ */
+void add_element(List * list, int value) {
+    insert_element(list, value, list->length);
+}
+
+/*
+ * Removes an existing node, freeing its memory.
+ * If the index is greater than or equal to the length of the list, removes the last element.
+ */
+void remove_element(List * list, int index) {
+    // If the index is nonsensical or the list has no nodes inside of it, ignore the command.
+    if (index < 0 || list->length == 0) {
+        return;
+    }
+    if (index >= list->length) {
+        index = list->length - 1;
+    }
+
+    Node * before[MAX_LEVEL];
+    int before_position[MAX_LEVEL];
+    find_predecessors(list, index, before, before_position);
+
+    Node * old_node = before[0]->links[0].next;
+    for (int l = 0; l < list->level; ++l) {
+        Link * link = &before[l]->links[l];
+        if (l < old_node->level) {
+            // Merge the removed node's link into the one that pointed at it.
+            link->next = old_node->links[l].next;
+            link->width += old_node->links[l].width - 1;
+        } else if (link->next) {
+            --link->width;
+        }
+    }
+    free(old_node);
+    --list->length;
+
+    // Drop levels that no longer hold any node.
+    while (list->level > 1 && !list->head->links[list->level - 1].next) {
+        --list->level;
+    }
+}
+
+/*
+ * Returns the node at the position given by index, or NULL if there is none.
+ */
+Node * get_element(List * list, int index) {
+    if (index < 0 || index >= list->length) {
+        return NULL;
+    }
+    Node * current = list->head;
+    int position = -1;
+    for (int l = list->level - 1; l >= 0; --l) {
+        while (current->links[l].next && position + current->links[l].width <= index) {
+            position += current->links[l].width;
+            current = current->links[l].next;
+        }
+        if (position == index) {
+            break;
+        }
+    }
+    return current;
+}
+
+/*
+ * Prints a visualization of the list.
+ */
+void print_list(List * list) {
+    Node * current = list->head->links[0].next;
+    while (current) {
+        printf("%d -> ", current->value);
+        current = current->links[0].next;
+    }
+    printf("null\n");
+}
+
+/*
+ * De-allocates heap memory allocated for the Node objects in the list, including the head.
+ */
+void free_list(List * list) {
+    Node * head = list->head;
+    Node * current;
+    while (head) {
+        current = head;
+        head = head->links[0].next;
+        free(current);
+    }
+    list->head = NULL;
+    list->length = 0;
+    list->level = 0;
+}
+
+/*
+ * Adapters from the batch mode backend interface to the list functions.
+ */
+void backend_add(void * list, int value) {
+    add_element((List *) list, value);
+}
+
+void backend_insert(void * list, int value, int index) {
+    insert_element((List *) list, value, index);
+}
+
+void backend_remove(void * list, int index) {
+    remove_element((List *) list, index);
+}
+
+void backend_print(void * list) {
+    print_list((List *) list);
+}
+
+/*
+ * Takes user input to build and manipulate the list and print the results.
+ */
+int main(int argc, char * argv[]) {
+    if (argc > 1) {
+        List list = make_list();
+        list_backend backend = {"skiplist", &list, backend_add, backend_insert,
+                                backend_remove, backend_print, NULL, NULL};
+        int status = batch_main(&backend, argc, argv);
+        free_list(&list);
+        return status;
+    }
+
+    char c;
+    int value;
+    int index;
+    List list = make_list();
+    printf(USAGE);
+    printf("> ");
+    while (scanf("%c", &c) != EOF) {
+        if (c == 'q') {
+            while (getchar() != (int)'\n');
+            break;
+        }
+        switch (c) {
+            case 'a':
+                scanf("%d", &value);
+                add_element(&list, value);
+                print_list(&list);
+                break;
+            case 'i':
+                scanf("%d %d", &value, &index);
+                insert_element(&list, value, index);
+                print_list(&list);
+                break;
+            case 'r':
+                scanf("%d", &index);
+                remove_element(&list, index);
+                print_list(&list);
+                break;
+            case 'g': {
+                scanf("%d", &index);
+                Node * node = get_element(&list, index);
+                if (node) {
+                    printf("%d\n", node->value);
+                } else {
+                    printf("null\n");
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        while (getchar() != (int)'\n');
+        printf("> ");
+    }
+    free_list(&list);
+    return EXIT_SUCCESS;
+}
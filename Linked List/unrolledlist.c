@@ -0,0 +1,455 @@
+/*
+ * Program to build and represent an unrolled linked list of integers. Every node is one 64-byte
+ * cache line holding up to NODE_CAPACITY values, so walking the list touches one cache line per
+ * thirteen elements instead of one per element.
+ * Run with --benchmark [length] to compare it against the one-value-per-node list, or with
+ * -b command_file to replay a file of commands without the interactive prompt.
+ * Compile with: gcc unrolledlist.c list_commands.c
+ *
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "list_commands.h"
+
+#define USAGE "Please enter one of the following commands:\n" \
+    "\ta <int> -- add <int> to the end of the list\n" \
+    "\ti <int> <index> -- insert <int> at position <index>\n" \
+    "\tr <index> -- remove element from position <index>\n" \
+    "\tq -- quit.\n"
+
+#define CACHE_LINE_SIZE 64
+// The values fill whatever is left of a cache line after the next pointer and the count.
+#define NODE_CAPACITY ((CACHE_LINE_SIZE - sizeof(void *) - sizeof(int)) / sizeof(int))
+
+#define BENCHMARK_LENGTH 100000
+#define BENCHMARK_OPERATIONS 1000
+#define BENCHMARK_TRAVERSALS 10
+
+typedef struct Node {
+    struct Node * next;
+    int count;
+    int values[NODE_CAPACITY];
+} Node;
+
+typedef struct List {
+    Node * head;
+    Node * tail;
+    int length;
+} List;
+
+/*
+ * Returns an empty Node object allocated on the heap, aligned to a cache line.
+ */
+Node * make_node() {
+    Node * new_node = (Node *)aligned_alloc(CACHE_LINE_SIZE, sizeof(Node));
+    new_node->next = NULL;
+    new_node->count = 0;
+    return new_node;
+}
+
+/*
+ * Allocates a new List object on the stack.
+ */
+List make_list() {
+    List new_list;
+    new_list.head = NULL;
+    new_list.tail = NULL;
+    new_list.length = 0;
+    return new_list;
+}
+
+/*
+ * Returns the node holding the element at the position given by index, which must be inside the
+ * list, and stores the element's position within that node in offset.
+ */
+Node * find_node(List * list, int index, int * offset) {
+    Node * current = list->head;
+    while (index >= current->count) {
+        index -= current->count;
+        current = current->next;
+    }
+    *offset = index;
+    return current;
+}
+
+/*
+ * Moves the upper half of a full node into a new node linked right after it.
+ */
+void split_node(List * list, Node * node) {
+    Node * new_node = make_node();
+    int keep = node->count / 2;
+    new_node->count = node->count - keep;
+    memcpy(new_node->values, node->values + keep, new_node->count * sizeof(int));
+    node->count = keep;
+    new_node->next = node->next;
+    node->next = new_node;
+    if (list->tail == node) {
+        list->tail = new_node;
+    }
+}
+
+/*
+ * Adds a new element with the given value to the end of the list.
+ */
+void add_element(List * list, int value) {
+    if (! list->tail || list->tail->count == (int) NODE_CAPACITY) {
+        Node * new_node = make_node();
+        if (! list->tail) {
+            list->head = new_node;
+        } else {
+            list->tail->next = new_node;
+        }
+        list->tail = new_node;
+    }
+    list->tail->values[list->tail->count++] = value;
+    ++list->length;
+}
+
+/*
+ * Removes an existing element. A node that drops below half full takes values from the node
+ * after it, or is merged into it if both fit in one node, so that nodes stay at least half full
+ * and traversals stay dense.
+ * If the index is greater than or equal to the length of the list, removes the last element.
+ */
+void remove_element(List * list, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    // If the list has no nodes inside of it, ignore the remove command.
+    else if (!list->head) {
+        return;
+    }
+    if (index >= list->length) {
+        index = list->length - 1;
+    }
+    int offset;
+    Node * node = find_node(list, index, &offset);
+    memmove(node->values + offset, node->values + offset + 1,
+            (node->count - offset - 1) * sizeof(int));
+    --node->count;
+    --list->length;
+
+    Node * next = node->next;
+    if (node->count >= (int) NODE_CAPACITY / 2) {
+        return;
+    }
+    if (next && node->count + next->count <= (int) NODE_CAPACITY) {
+        // Merge the next node into this one.
+        memcpy(node->values + node->count, next->values, next->count * sizeof(int));
+        node->count += next->count;
+        node->next = next->next;
+        if (list->tail == next) {
+            list->tail = node;
+        }
+        free(next);
+    } else if (next) {
+        // Borrow enough values from the next node to even the two out.
+        int moved = (next->count - node->count) / 2;
+        memcpy(node->values + node->count, next->values, moved * sizeof(int));
+        memmove(next->values, next->values + moved, (next->count - moved) * sizeof(int));
+        node->count += moved;
+        next->count -= moved;
+    } else if (node->count == 0) {
+        // The last node is empty, so unlink it. Only the last node may be less than half full.
+        Node * before = list->head;
+        if (before == node) {
+            list->head = NULL;
+            list->tail = NULL;
+        } else {
+            while (before->next != node) {
+                before = before->next;
+            }
+            before->next = NULL;
+            list->tail = before;
+        }
+        free(node);
+    }
+}
+
+/*
+ * Inserts a new element into the list with the given value at the position given by index.
+ * If the index reaches beyond the end of the list, appends the new element to the end.
+ */
+void insert_element(List * list, int value, int index) {
+    // If the index is nonsensical, just ignore it.
+    if (index < 0) {
+        return;
+    }
+    if (index >= list->length) {
+        add_element(list, value);
+        return;
+    }
+    int offset;
+    Node * node = find_node(list, index, &offset);
+    if (node->count == (int) NODE_CAPACITY) {
+        split_node(list, node);
+        if (offset >= node->count) {
+            offset -= node->count;
+            node = node->next;
+        }
+    }
+    memmove(node->values + offset + 1, node->values + offset,
+            (node->count - offset) * sizeof(int));
+    node->values[offset] = value;
+    ++node->count;
+    ++list->length;
+}
+
+/*
+ * Prints a visualization of the list.
+ */
+void print_list(List * list) {
+    Node * current = list->head;
+    while (current) {
+        for (int i = 0; i < current->count; ++i) {
+            printf("%d -> ", current->values[i]);
+        }
+        current = current->next;
+    }
+    printf("null\n");
+}
+
+/*
+ * De-allocates heap memory allocated for the Node objects in the list.
+ */
+void free_list(List * list) {
+    Node * head = list->head;
+    Node * current;
+    while (head) {
+        current = head;
+        head = head->next;
+        free(current);
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->length = 0;
+}
+
+/*
+ * The list from linkedlist3.c, with one value per node, as the baseline for the benchmark.
+ */
+typedef struct LinkedNode {
+    int value;
+    struct LinkedNode * next;
+} LinkedNode;
+
+/*
+ * Inserts value at index in a one-value-per-node list, walking from the head.
+ */
+void linked_insert(LinkedNode ** head, int value, int index) {
+    LinkedNode * new_node = (LinkedNode *)malloc(sizeof(LinkedNode));
+    new_node->value = value;
+    LinkedNode ** link = head;
+    for (int i = 0; i < index && *link; ++i) {
+        link = &(*link)->next;
+    }
+    new_node->next = *link;
+    *link = new_node;
+}
+
+/*
+ * Removes the element at index from a one-value-per-node list, walking from the head.
+ */
+void linked_remove(LinkedNode ** head, int index) {
+    LinkedNode ** link = head;
+    for (int i = 0; i < index && (*link)->next; ++i) {
+        link = &(*link)->next;
+    }
+    LinkedNode * old_node = *link;
+    *link = old_node->next;
+    free(old_node);
+}
+
+/*
+ * Times traversals, random positional inserts, and random positional removes on a list of the
+ * given length, once for the unrolled list and once for the one-value-per-node list.
+ */
+void benchmark(int length) {
+    clock_t start;
+    clock_t end;
+    long sum = 0;
+    long linked_sum = 0;
+
+    // Link the baseline's nodes in a random order, as they end up after a long run of inserts
+    // and removes, rather than in the order malloc happened to lay them out.
+    LinkedNode ** nodes = (LinkedNode **)malloc(length * sizeof(LinkedNode *));
+    for (int i = 0; i < length; ++i) {
+        nodes[i] = (LinkedNode *)malloc(sizeof(LinkedNode));
+    }
+    for (int i = length - 1; i > 0; --i) {
+        int j = rand() % (i + 1);
+        LinkedNode * swap = nodes[i];
+        nodes[i] = nodes[j];
+        nodes[j] = swap;
+    }
+    for (int i = 0; i < length; ++i) {
+        nodes[i]->value = i;
+        nodes[i]->next = i + 1 < length ? nodes[i + 1] : NULL;
+    }
+    LinkedNode * linked_head = length > 0 ? nodes[0] : NULL;
+    free(nodes);
+
+    List list = make_list();
+    for (int i = 0; i < length; ++i) {
+        add_element(&list, i);
+    }
+
+    printf("length = %i, %i values per node\n\n", length, (int) NODE_CAPACITY);
+    printf("%-24s %14s %14s\n", "", "linked", "unrolled");
+
+    start = clock();
+    for (int t = 0; t < BENCHMARK_TRAVERSALS; ++t) {
+        for (LinkedNode * current = linked_head; current; current = current->next) {
+            linked_sum += current->value;
+        }
+    }
+    end = clock();
+    double linked_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int t = 0; t < BENCHMARK_TRAVERSALS; ++t) {
+        for (Node * current = list.head; current; current = current->next) {
+            for (int i = 0; i < current->count; ++i) {
+                sum += current->values[i];
+            }
+        }
+    }
+    end = clock();
+    double unrolled_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+    printf("%-24s %13lfs %13lfs\n", "traversal", linked_time / BENCHMARK_TRAVERSALS,
+           unrolled_time / BENCHMARK_TRAVERSALS);
+
+    // Generate the positions up front so both lists see the same operations.
+    int * indexes = (int *)malloc(BENCHMARK_OPERATIONS * sizeof(int));
+    for (int i = 0; i < BENCHMARK_OPERATIONS; ++i) {
+        indexes[i] = length > 0 ? rand() % length : 0;
+    }
+
+    start = clock();
+    for (int i = 0; i < BENCHMARK_OPERATIONS; ++i) {
+        linked_insert(&linked_head, i, indexes[i]);
+    }
+    end = clock();
+    linked_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int i = 0; i < BENCHMARK_OPERATIONS; ++i) {
+        insert_element(&list, i, indexes[i]);
+    }
+    end = clock();
+    unrolled_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+    printf("%-24s %13lfs %13lfs\n", "positional insert", linked_time / BENCHMARK_OPERATIONS,
+           unrolled_time / BENCHMARK_OPERATIONS);
+
+    start = clock();
+    for (int i = 0; i < BENCHMARK_OPERATIONS; ++i) {
+        linked_remove(&linked_head, indexes[i]);
+    }
+    end = clock();
+    linked_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int i = 0; i < BENCHMARK_OPERATIONS; ++i) {
+        remove_element(&list, indexes[i]);
+    }
+    end = clock();
+    unrolled_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+    printf("%-24s %13lfs %13lfs\n", "positional remove", linked_time / BENCHMARK_OPERATIONS,
+           unrolled_time / BENCHMARK_OPERATIONS);
+
+    // Both lists went through the same operations, so they must hold the same values.
+    int same = sum == linked_sum;
+    LinkedNode * linked_current = linked_head;
+    for (Node * current = list.head; current; current = current->next) {
+        for (int i = 0; i < current->count; ++i) {
+            same = same && linked_current && linked_current->value == current->values[i];
+            linked_current = linked_current ? linked_current->next : NULL;
+        }
+    }
+    same = same && !linked_current;
+    printf("\n%s\n", same ? "RESULTS ARE THE SAME" : "RESULTS ARE NOT THE SAME");
+
+    free(indexes);
+    while (linked_head) {
+        LinkedNode * current = linked_head;
+        linked_head = linked_head->next;
+        free(current);
+    }
+    free_list(&list);
+}
+
+/*
+ * Adapters from the batch mode backend interface to the list functions.
+ */
+void backend_add(void * list, int value) {
+    add_element((List *) list, value);
+}
+
+void backend_insert(void * list, int value, int index) {
+    insert_element((List *) list, value, index);
+}
+
+void backend_remove(void * list, int index) {
+    remove_element((List *) list, index);
+}
+
+void backend_print(void * list) {
+    print_list((List *) list);
+}
+
+/*
+ * Takes user input to build and manipulate the list and print the results.
+ */
+int main(int argc, char * argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        benchmark(argc > 2 ? atoi(argv[2]) : BENCHMARK_LENGTH);
+        return EXIT_SUCCESS;
+    }
+    if (argc > 1) {
+        List list = make_list();
+        list_backend backend = {"unrolledlist", &list, backend_add, backend_insert,
+                                backend_remove, backend_print, NULL, NULL};
+        int status = batch_main(&backend, argc, argv);
+        free_list(&list);
+        return status;
+    }
+
+    char c;
+    int value;
+    int index;
+    List list = make_list();
+    printf(USAGE);
+    printf("> ");
+    while (scanf("%c", &c) != EOF) {
+        if (c == 'q') {
+            while (getchar() != (int)'\n');
+            break;
+        }
+        switch (c) {
+            case 'a':
+                scanf("%d", &value);
+                add_element(&list, value);
+                print_list(&list);
+                break;
+            case 'i':
+                scanf("%d %d", &value, &index);
+                insert_element(&list, value, index);
+                print_list(&list);
+                break;
+            case 'r':
+                scanf("%d", &index);
+                remove_element(&list, index);
+                print_list(&list);
+                break;
+            default:
+                break;
+        }
+        while (getchar() != (int)'\n');
+        printf("> ");
+    }
+    free_list(&list);
+    return EXIT_SUCCESS;
+}
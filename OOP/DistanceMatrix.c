@@ -0,0 +1,255 @@
+/*
+ * Program to compute the distances between every pair of points in a PointSet, tiled so the
+ * coordinates being compared stay in cache, measured with PointSet's AVX2 row kernel, and split
+ * across threads.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "DistanceMatrix.h"
+
+// Rows are computed against this many columns at a time, whose coordinates take 16KB and stay
+// in the L1 cache across all the rows of a block.
+#define TILE_COLUMNS 1024
+// Threads take this many rows of the matrix at a time.
+#define BLOCK_ROWS 16
+// Streaming computes bands of rows of about this size while the previous band is written.
+#define STREAM_BAND_BYTES (64 << 20)
+
+// Define the DistanceMatrixData struct in DistanceMatrix.c so callers can not access it.
+typedef struct DistanceMatrixData {
+    double * values;
+    size_t count;
+    int upper_triangle;
+} DistanceMatrixData;
+
+// Obtain the position of the first stored distance of a row among all the stored distances.
+static size_t row_offset(size_t count, size_t row, int upper_triangle) {
+    return upper_triangle ? row * (2 * count - row - 1) / 2 : row * count;
+}
+
+// Obtain the first column stored for a row.
+static size_t first_column(size_t row, int upper_triangle) {
+    return upper_triangle ? row + 1 : 0;
+}
+
+// The rows from row_start up to row_end of a matrix, stored in out starting from the first
+// column of row_start. Threads take blocks of rows by counting up next_block.
+typedef struct band_parameters {
+    const double * x;
+    const double * y;
+    size_t count;
+    int upper_triangle;
+    size_t row_start;
+    size_t row_end;
+    double * out;
+    atomic_size_t next_block;
+} band_parameters;
+
+// Compute the rows from block_start up to block_end, one tile of columns at a time for all of
+// the rows, so that the tile is read from memory once per block instead of once per row.
+static void compute_block(band_parameters * band, size_t block_start, size_t block_end) {
+    size_t count = band->count;
+    int upper_triangle = band->upper_triangle;
+    size_t band_offset = row_offset(count, band->row_start, upper_triangle);
+    for (size_t tile = first_column(block_start, upper_triangle); tile < count;
+         tile += TILE_COLUMNS) {
+        size_t tile_end = tile + TILE_COLUMNS < count ? tile + TILE_COLUMNS : count;
+        for (size_t i = block_start; i < block_end; i++) {
+            size_t row_first = first_column(i, upper_triangle);
+            size_t start = tile > row_first ? tile : row_first;
+            if (start >= tile_end) {
+                continue;
+            }
+            double * out = band->out + row_offset(count, i, upper_triangle) - band_offset +
+                           (start - row_first);
+            PointSet_distance_row(band->x[i], band->y[i], band->x + start, band->y + start,
+                                  tile_end - start, 1, out);
+        }
+    }
+}
+
+// Take blocks of rows of the band until there are none left. Blocks are handed out one at a
+// time because the rows of the upper triangle shrink, so equal shares would not be equal work.
+static void * band_worker(void * arguments) {
+    band_parameters * band = (band_parameters *) arguments;
+    while (1) {
+        size_t block_start = band->row_start + BLOCK_ROWS * atomic_fetch_add(&band->next_block, 1);
+        if (block_start >= band->row_end) {
+            return NULL;
+        }
+        size_t block_end = block_start + BLOCK_ROWS < band->row_end ? block_start + BLOCK_ROWS
+                                                                    : band->row_end;
+        compute_block(band, block_start, block_end);
+    }
+}
+
+// Compute the rows from row_start up to row_end into out with threads threads.
+static void compute_band(PointSet * set, int upper_triangle, size_t row_start, size_t row_end,
+                         double * out, int threads) {
+    band_parameters band;
+    band.x = set->x_coordinates(set);
+    band.y = set->y_coordinates(set);
+    band.count = set->size(set);
+    band.upper_triangle = upper_triangle;
+    band.row_start = row_start;
+    band.row_end = row_end;
+    band.out = out;
+    atomic_init(&band.next_block, 0);
+
+    pthread_t * workers = (pthread_t *) malloc(threads * sizeof(pthread_t));
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&workers[t], NULL, &band_worker, &band);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+}
+
+// Obtain the number of threads to use, one per processor if threads is 0.
+static int thread_count(int threads) {
+    if (threads <= 0) {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return threads > 0 ? threads : 1;
+}
+
+// Obtain the number of points in the matrix.
+size_t DistanceMatrix_size(DistanceMatrix * this) {
+    return this->data->count;
+}
+
+// Obtain the distance between points i and j, or NAN if either is not in the matrix.
+double DistanceMatrix_get(DistanceMatrix * this, size_t i, size_t j) {
+    DistanceMatrixData * data = this->data;
+    if (i >= data->count || j >= data->count) {
+        return NAN;
+    }
+    if (!data->upper_triangle) {
+        return data->values[i * data->count + j];
+    }
+    if (i == j) {
+        return 0;
+    }
+    // Only the distance from the earlier point to the later one is stored.
+    if (i > j) {
+        size_t swap = i;
+        i = j;
+        j = swap;
+    }
+    return data->values[row_offset(data->count, i, 1) + (j - first_column(i, 1))];
+}
+
+// Free memory in the heap associated with a DistanceMatrix.
+void DistanceMatrix_delete(DistanceMatrix * this) {
+    free(this->data->values);
+    free(this->data);
+    free(this);
+}
+
+// Declare a DistanceMatrix object in the heap holding the distances between the points of set.
+DistanceMatrix * DistanceMatrix_new(PointSet * set, int upper_triangle, int threads) {
+    size_t count = set->size(set);
+    size_t total = row_offset(count, count, upper_triangle);
+    double * values = (double *) malloc(total * sizeof(double));
+    if (values == NULL && total > 0) {
+        return NULL;
+    }
+    compute_band(set, upper_triangle, 0, count, values, thread_count(threads));
+
+    DistanceMatrix * newDistanceMatrix = (DistanceMatrix *) malloc(sizeof(DistanceMatrix));
+    newDistanceMatrix->data = (DistanceMatrixData *) malloc(sizeof(DistanceMatrixData));
+    newDistanceMatrix->data->values = values;
+    newDistanceMatrix->data->count = count;
+    newDistanceMatrix->data->upper_triangle = upper_triangle;
+    newDistanceMatrix->size = &DistanceMatrix_size;
+    newDistanceMatrix->get = &DistanceMatrix_get;
+    newDistanceMatrix->delete = &DistanceMatrix_delete;
+    return newDistanceMatrix;
+}
+
+typedef struct write_parameters {
+    FILE * fptr;
+    double * values;
+    size_t count;
+    int failed;
+} write_parameters;
+
+// Write a computed band to the file.
+static void * band_writer(void * arguments) {
+    write_parameters * parameters = (write_parameters *) arguments;
+    if (fwrite(parameters->values, sizeof(double), parameters->count, parameters->fptr) !=
+        parameters->count) {
+        parameters->failed = 1;
+    }
+    return NULL;
+}
+
+// Compute the matrix into one buffer while a thread writes the band before it from the other.
+int DistanceMatrix_stream(PointSet * set, const char * path, int upper_triangle, int threads) {
+    FILE * fptr = fopen(path, "wb");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return -1;
+    }
+    threads = thread_count(threads);
+    size_t count = set->size(set);
+    // A band holds at least one whole row, however long the rows are.
+    size_t band_capacity = STREAM_BAND_BYTES / sizeof(double);
+    if (band_capacity < count) {
+        band_capacity = count;
+    }
+    double * buffers[2];
+    buffers[0] = (double *) malloc(band_capacity * sizeof(double));
+    buffers[1] = (double *) malloc(band_capacity * sizeof(double));
+    if (buffers[0] == NULL || buffers[1] == NULL) {
+        printf("Not enough memory to stream the matrix\n");
+        free(buffers[0]);
+        free(buffers[1]);
+        fclose(fptr);
+        return -1;
+    }
+
+    pthread_t writer;
+    write_parameters written = {fptr, NULL, 0, 0};
+    int writing = 0;
+    int buffer = 0;
+    size_t row_start = 0;
+    while (row_start < count) {
+        // Take as many rows as fit in a band.
+        size_t row_end = row_start;
+        size_t band_offset = row_offset(count, row_start, upper_triangle);
+        while (row_end < count &&
+               row_offset(count, row_end + 1, upper_triangle) - band_offset <= band_capacity) {
+            ++row_end;
+        }
+        compute_band(set, upper_triangle, row_start, row_end, buffers[buffer], threads);
+
+        if (writing) {
+            pthread_join(writer, NULL);
+        }
+        written.values = buffers[buffer];
+        written.count = row_offset(count, row_end, upper_triangle) - band_offset;
+        pthread_create(&writer, NULL, &band_writer, &written);
+        writing = 1;
+        buffer = !buffer;
+        row_start = row_end;
+    }
+    if (writing) {
+        pthread_join(writer, NULL);
+    }
+
+    free(buffers[0]);
+    free(buffers[1]);
+    if (fclose(fptr) != 0 || written.failed) {
+        printf("File could not be written\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include <stddef.h>
+#include "PointSet.h"
+
+// The distances between every pair of points in a PointSet. The full matrix stores every row
+// whole. The upper triangle stores only the distances from each point to the points after it,
+// about half the memory, and get looks up the other half by symmetry.
+typedef struct DistanceMatrix {
+    size_t (*size)(struct DistanceMatrix *);
+    double (*get)(struct DistanceMatrix *, size_t i, size_t j);
+    void (*delete)(struct DistanceMatrix *);
+    struct DistanceMatrixData * data;
+} DistanceMatrix;
+
+// Compute the matrix with threads threads, or one per processor if threads is 0. Returns NULL if
+// the matrix does not fit in memory.
+DistanceMatrix * DistanceMatrix_new(PointSet * set, int upper_triangle, int threads);
+
+// Compute the matrix a band of rows at a time and write it to a file as raw doubles, row after
+// row, so that it never has to fit in memory. With upper_triangle set, row i holds only the
+// distances to points i + 1 onward. Returns 0 on success and -1 if the file can not be written or
+// the two bands being computed and written do not fit in memory.
+int DistanceMatrix_stream(PointSet * set, const char * path, int upper_triangle, int threads);
+
+#endif
@@ -6,34 +6,63 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "Point.h"
+#include "../Floating Point/float_format.h"
 
-#define MAX_STRING_SIZE 64
+// Room for "(x, y)" with both coordinates formatted as "%f" would.
+#define MAX_STRING_SIZE (2 * FORMAT_FIXED_SIZE(6) + 4)
+#define DEFAULT_POOL_CAPACITY 1024
 
-// Define the PointData struct in Point.c so main can not access it.
+// Define the PointData struct in Point.c so main can not access it. pool is the PointPool the
+// Point came from, or NULL if it was allocated on its own. to_string stays NULL until the Point
+// is first printed, so Points that are never printed do not pay for formatting or the string.
 typedef struct PointData {
     double x;
     double y;
-    char to_string[MAX_STRING_SIZE];
+    struct PointPool * pool;
+    char * to_string;
 } PointData;
 
-// Declare a PointData object in the heap and initialize it.
-PointData * PointData_new(double x, double y) {
-    PointData * newPointData = (PointData *) malloc(sizeof(PointData));
-    newPointData->x = x;
-    newPointData->y = y;
-    sprintf(newPointData->to_string, "(%f, %f)", x, y);
-    return newPointData;
+// A Point and its PointData in one allocation, so creating a Point takes a single malloc and its
+// data sits right after its methods in memory. next_free links Points deleted back into a pool.
+typedef struct PointObject {
+    Point point;
+    PointData data;
+    struct PointObject * next_free;
+} PointObject;
+
+// A block of PointObjects allocated with a single malloc.
+typedef struct PointSlab {
+    struct PointSlab * next;
+    size_t capacity;
+    PointObject objects[];
+} PointSlab;
+
+// Define the PointPoolData struct in Point.c so main can not access it. Deleted Points are kept
+// on free_points and reused before any new slab space is taken.
+typedef struct PointPoolData {
+    PointSlab * slabs;
+    size_t slab_used;
+    size_t slab_capacity;
+    PointObject * free_points;
+} PointPoolData;
+
+// Put a deleted Point from a pool on the pool's free list.
+void PointPool_release(PointPool * this, PointObject * object) {
+    free(object->data.to_string);
+    object->data.to_string = NULL;
+    object->next_free = this->data->free_points;
+    this->data->free_points = object;
 }
 
-typedef struct Point {
-    double (*x)(struct Point *);
-    double (*y)(struct Point *);
-    double (*magnitude)(struct Point *);
-    double (*distance)(struct Point *, struct Point *);
-    char * (*to_string)(struct Point *);
-    void (*delete)(struct Point *);
-    struct PointData * data;
-} Point;
+// Initialize the PointData of a Point.
+void PointData_init(PointData * data, double x, double y, struct PointPool * pool) {
+    data->x = x;
+    data->y = y;
+    data->pool = pool;
+    data->to_string = NULL;
+}
 
 // Extract the x coordinate of a Point.
 double Point_x(Point * this) {
@@ -49,7 +78,7 @@ double Point_y(Point * this) {
 double Point_magnitude(Point * this) {
     double x = this->data->x;
     double y = this->data->y;
-    
+
     // Calculate the absolute value of the hypotenuse of the triangle formed by the line from the
     // origin to the x coordinate and the line from the origin to the y coordinate.
     return fabs(sqrt(x * x + y * y));
@@ -62,36 +91,133 @@ double Point_distance(struct Point * this, struct Point * that){
     double y1 = this->data->y;
     double x2 = that->data->x;
     double y2 = that->data->y;
-    
+
     // Calculate the difference between the x and y coordinates.
     double delta_x = x2 - x1;
     double delta_y = y2 - y1;
-    
+
     // Calculate the relative distance of the hypotenuse of the triangle formed by the line from one
     // x coordinate to another and the line from one y coordinate to the other.
     return sqrt(delta_x * delta_x + delta_y * delta_y);
 }
 
-// Obtain the string format of a Point.
+// Obtain the string format of a Point, formatting it on the first call and keeping the result.
 char * Point_to_string(struct Point * this) {
-    return this->data->to_string;
+    PointData * data = this->data;
+    if (data->to_string) {
+        return data->to_string;
+    }
+
+    char text[MAX_STRING_SIZE];
+    int length = 0;
+    text[length++] = '(';
+    length += format_fixed(text + length, data->x, 6);
+    text[length++] = ',';
+    text[length++] = ' ';
+    length += format_fixed(text + length, data->y, 6);
+    text[length++] = ')';
+    text[length] = '\0';
+    data->to_string = (char *) malloc(length + 1);
+    memcpy(data->to_string, text, length + 1);
+    return data->to_string;
 }
 
-// Free memory in the heap associated with a Point.
+// Free memory in the heap associated with a Point, or give it back to its pool.
 void Point_delete(struct Point * this) {
-    free(this->data);
-    free(this);
+    PointObject * object = (PointObject *) this;
+    if (object->data.pool) {
+        PointPool_release(object->data.pool, object);
+    } else {
+        free(object->data.to_string);
+        free(object);
+    }
+}
+
+// The methods every Point is created with. Copying this whole struct fills in all six method
+// pointers of a new Point at once instead of assigning them one by one.
+const Point Point_methods = {
+    &Point_x,
+    &Point_y,
+    &Point_magnitude,
+    &Point_distance,
+    &Point_to_string,
+    &Point_delete,
+    NULL,
+};
+
+// Initialize the Point stored in a PointObject.
+Point * PointObject_init(PointObject * object, double x, double y, struct PointPool * pool) {
+    object->point = Point_methods;
+    object->point.data = &object->data;
+    PointData_init(&object->data, x, y, pool);
+    return &object->point;
 }
 
 // Declare a Point object in the heap and initialize it
 Point * Point_new(double x, double y) {
-    Point * newPoint = (Point *) malloc(sizeof(Point));
-    newPoint->data = PointData_new(x,y);
-    newPoint->x = &Point_x;
-    newPoint->y = &Point_y;
-    newPoint->magnitude = &Point_magnitude;
-    newPoint->distance = &Point_distance;
-    newPoint->to_string = &Point_to_string;
-    newPoint->delete = &Point_delete;
-    return newPoint;
+    PointObject * newPoint = (PointObject *) malloc(sizeof(PointObject));
+    return PointObject_init(newPoint, x, y, NULL);
+}
+
+// Take a PointObject from the free list, or from the current slab, starting a new slab twice as
+// large as the last when the current one is used up.
+PointObject * PointPool_take(PointPool * this) {
+    PointPoolData * data = this->data;
+    PointObject * object = data->free_points;
+    if (object) {
+        data->free_points = object->next_free;
+        return object;
+    }
+    if (!data->slabs || data->slab_used == data->slabs->capacity) {
+        size_t capacity = data->slabs ? data->slabs->capacity * 2 : data->slab_capacity;
+        PointSlab * slab = (PointSlab *) malloc(sizeof(PointSlab) +
+                                                capacity * sizeof(PointObject));
+        slab->next = data->slabs;
+        slab->capacity = capacity;
+        data->slabs = slab;
+        data->slab_used = 0;
+    }
+    return &data->slabs->objects[data->slab_used++];
+}
+
+// Create a Point from the pool.
+Point * PointPool_new_point(PointPool * this, double x, double y) {
+    return PointObject_init(PointPool_take(this), x, y, this);
+}
+
+// Create count Points from the pool, the ith at (x[i], y[i]), and store them in out.
+void PointPool_new_points(PointPool * this, double * x, double * y, size_t count,
+                          Point ** out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = PointObject_init(PointPool_take(this), x[i], y[i], this);
+    }
+}
+
+// Free the pool along with every Point it handed out, deleted or not.
+void PointPool_delete(PointPool * this) {
+    PointSlab * slab = this->data->slabs;
+    // Only the newest slab can be partly used; deleted Points already had their strings freed.
+    size_t used = this->data->slab_used;
+    while (slab) {
+        for (size_t i = 0; i < used; i++) {
+            free(slab->objects[i].data.to_string);
+        }
+        PointSlab * next = slab->next;
+        free(slab);
+        slab = next;
+        used = slab ? slab->capacity : 0;
+    }
+    free(this->data);
+    free(this);
+}
+
+// Declare a PointPool object in the heap whose first slab holds capacity Points.
+PointPool * PointPool_new(size_t capacity) {
+    PointPool * newPointPool = (PointPool *) malloc(sizeof(PointPool));
+    newPointPool->data = (PointPoolData *) calloc(1, sizeof(PointPoolData));
+    newPointPool->data->slab_capacity = capacity > 0 ? capacity : DEFAULT_POOL_CAPACITY;
+    newPointPool->new_point = &PointPool_new_point;
+    newPointPool->new_points = &PointPool_new_points;
+    newPointPool->delete = &PointPool_delete;
+    return newPointPool;
 }
@@ -1,3 +1,8 @@
+#ifndef POINT_H
+#define POINT_H
+
+#include <stddef.h>
+
 typedef struct Point {
     double (*x)(struct Point *);
     double (*y)(struct Point *);
@@ -10,3 +15,16 @@ typedef struct Point {
 
 Point * Point_new(double x, double y);
 
+// Hands out Points from large blocks instead of one malloc each. A Point from a pool is used like
+// any other, and its delete method returns it to the pool for reuse. Deleting the pool frees
+// every Point it handed out at once.
+typedef struct PointPool {
+    Point * (*new_point)(struct PointPool *, double x, double y);
+    void (*new_points)(struct PointPool *, double * x, double * y, size_t count, Point ** out);
+    void (*delete)(struct PointPool *);
+    struct PointPoolData * data;
+} PointPool;
+
+PointPool * PointPool_new(size_t capacity);
+
+#endif
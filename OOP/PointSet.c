@@ -0,0 +1,192 @@
+/*
+ * Program to store many Points as a structure of arrays and measure them in batches with SIMD.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PointSet.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+// Coordinate arrays are aligned to, and sized in multiples of, one AVX2 vector of doubles.
+#define VECTOR_BYTES 32
+#define VECTOR_WIDTH 4
+#define DEFAULT_CAPACITY 16
+
+// Define the PointSetData struct in PointSet.c so callers can not access it.
+typedef struct PointSetData {
+    double * x;
+    double * y;
+    size_t size;
+    size_t capacity;
+} PointSetData;
+
+// Allocate an aligned array with room for capacity doubles.
+static double * coordinates_new(size_t capacity) {
+    return (double *) aligned_alloc(VECTOR_BYTES, capacity * sizeof(double));
+}
+
+// Make room for at least capacity points, keeping the points already in the set.
+static void PointSet_reserve(PointSet * this, size_t capacity) {
+    PointSetData * data = this->data;
+    if (capacity <= data->capacity) {
+        return;
+    }
+    capacity = (capacity + VECTOR_WIDTH - 1) / VECTOR_WIDTH * VECTOR_WIDTH;
+    double * x = coordinates_new(capacity);
+    double * y = coordinates_new(capacity);
+    if (data->size > 0) {
+        memcpy(x, data->x, data->size * sizeof(double));
+        memcpy(y, data->y, data->size * sizeof(double));
+    }
+    free(data->x);
+    free(data->y);
+    data->x = x;
+    data->y = y;
+    data->capacity = capacity;
+}
+
+// Obtain the number of points in the set.
+size_t PointSet_size(PointSet * this) {
+    return this->data->size;
+}
+
+// Copy the coordinates of a Point onto the end of the set.
+void PointSet_add(PointSet * this, Point * point) {
+    PointSetData * data = this->data;
+    if (data->size == data->capacity) {
+        PointSet_reserve(this, data->capacity * 2);
+    }
+    data->x[data->size] = point->x(point);
+    data->y[data->size] = point->y(point);
+    ++data->size;
+}
+
+// Create a new Point from the point at index, which the caller must delete.
+Point * PointSet_get(PointSet * this, size_t index) {
+    if (index >= this->data->size) {
+        return NULL;
+    }
+    return Point_new(this->data->x[index], this->data->y[index]);
+}
+
+// Write the squared distance from (origin_x, origin_y) to each of count points into out, or the
+// distance itself if take_root is set.
+static void distance_row(double origin_x, double origin_y, const double * x, const double * y,
+                         size_t count, int take_root, double * out) {
+    for (size_t i = 0; i < count; i++) {
+        double delta_x = x[i] - origin_x;
+        double delta_y = y[i] - origin_y;
+        double squared = delta_x * delta_x + delta_y * delta_y;
+        out[i] = take_root ? sqrt(squared) : squared;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+// The same loop with AVX2, four points per instruction. Callers such as DistanceMatrix pass rows
+// that start at any point, so nothing here is assumed to be aligned.
+__attribute__((target("avx2")))
+static void distance_row_avx2(double origin_x, double origin_y, const double * x,
+                              const double * y, size_t count, int take_root, double * out) {
+    __m256d origin_xs = _mm256_set1_pd(origin_x);
+    __m256d origin_ys = _mm256_set1_pd(origin_y);
+    size_t i = 0;
+    for (; i + VECTOR_WIDTH <= count; i += VECTOR_WIDTH) {
+        __m256d delta_x = _mm256_sub_pd(_mm256_loadu_pd(x + i), origin_xs);
+        __m256d delta_y = _mm256_sub_pd(_mm256_loadu_pd(y + i), origin_ys);
+        __m256d squared = _mm256_add_pd(_mm256_mul_pd(delta_x, delta_x),
+                                       _mm256_mul_pd(delta_y, delta_y));
+        _mm256_storeu_pd(out + i, take_root ? _mm256_sqrt_pd(squared) : squared);
+    }
+    // Finish the points that do not fill a vector one at a time.
+    distance_row(origin_x, origin_y, x + i, y + i, count - i, take_root, out + i);
+}
+#endif
+
+// Pick the AVX2 loop when the processor has it.
+void PointSet_distance_row(double origin_x, double origin_y, const double * x, const double * y,
+                           size_t count, int take_root, double * out) {
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        distance_row_avx2(origin_x, origin_y, x, y, count, take_root, out);
+        return;
+    }
+#endif
+    distance_row(origin_x, origin_y, x, y, count, take_root, out);
+}
+
+// Measure every point of a set from (origin_x, origin_y).
+static void distances(PointSetData * data, double origin_x, double origin_y, int take_root,
+                      double * out) {
+    PointSet_distance_row(origin_x, origin_y, data->x, data->y, data->size, take_root, out);
+}
+
+// Obtain the magnitude of every point in the set.
+void PointSet_magnitudes(PointSet * this, double * out) {
+    distances(this->data, 0, 0, 1, out);
+}
+
+// Obtain the squared magnitude of every point, which orders points the same way without a root.
+void PointSet_squared_magnitudes(PointSet * this, double * out) {
+    distances(this->data, 0, 0, 0, out);
+}
+
+// Obtain the distance from every point in the set to a Point.
+void PointSet_distances_to(PointSet * this, Point * point, double * out) {
+    distances(this->data, point->x(point), point->y(point), 1, out);
+}
+
+// Obtain the squared distance from every point in the set to a Point.
+void PointSet_squared_distances_to(PointSet * this, Point * point, double * out) {
+    distances(this->data, point->x(point), point->y(point), 0, out);
+}
+
+// Obtain the array of x coordinates of the set.
+const double * PointSet_x_coordinates(PointSet * this) {
+    return this->data->x;
+}
+
+// Obtain the array of y coordinates of the set.
+const double * PointSet_y_coordinates(PointSet * this) {
+    return this->data->y;
+}
+
+// Free memory in the heap associated with a PointSet.
+void PointSet_delete(PointSet * this) {
+    free(this->data->x);
+    free(this->data->y);
+    free(this->data);
+    free(this);
+}
+
+// Declare an empty PointSet object in the heap with room for capacity points.
+PointSet * PointSet_new(size_t capacity) {
+    PointSet * newPointSet = (PointSet *) malloc(sizeof(PointSet));
+    newPointSet->data = (PointSetData *) calloc(1, sizeof(PointSetData));
+    newPointSet->size = &PointSet_size;
+    newPointSet->add = &PointSet_add;
+    newPointSet->get = &PointSet_get;
+    newPointSet->magnitudes = &PointSet_magnitudes;
+    newPointSet->squared_magnitudes = &PointSet_squared_magnitudes;
+    newPointSet->distances_to = &PointSet_distances_to;
+    newPointSet->squared_distances_to = &PointSet_squared_distances_to;
+    newPointSet->x_coordinates = &PointSet_x_coordinates;
+    newPointSet->y_coordinates = &PointSet_y_coordinates;
+    newPointSet->delete = &PointSet_delete;
+    PointSet_reserve(newPointSet, capacity > 0 ? capacity : DEFAULT_CAPACITY);
+    return newPointSet;
+}
+
+// Declare a PointSet object in the heap holding the coordinates of count Points.
+PointSet * PointSet_from_points(Point ** points, size_t count) {
+    PointSet * newPointSet = PointSet_new(count);
+    for (size_t i = 0; i < count; i++) {
+        PointSet_add(newPointSet, points[i]);
+    }
+    return newPointSet;
+}
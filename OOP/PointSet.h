@@ -0,0 +1,35 @@
+#ifndef POINTSET_H
+#define POINTSET_H
+
+#include <stddef.h>
+#include "Point.h"
+
+// A growable set of points stored as one array of x coordinates and one of y coordinates, so
+// that the batch methods run over contiguous memory instead of calling into each Point. Results
+// are written to out, which must hold size(set) doubles.
+typedef struct PointSet {
+    size_t (*size)(struct PointSet *);
+    void (*add)(struct PointSet *, Point *);
+    Point * (*get)(struct PointSet *, size_t);
+    void (*magnitudes)(struct PointSet *, double * out);
+    void (*squared_magnitudes)(struct PointSet *, double * out);
+    void (*distances_to)(struct PointSet *, Point *, double * out);
+    void (*squared_distances_to)(struct PointSet *, Point *, double * out);
+    // The coordinate arrays themselves, for kernels that work on whole sets of points. They are
+    // only valid until the next add.
+    const double * (*x_coordinates)(struct PointSet *);
+    const double * (*y_coordinates)(struct PointSet *);
+    void (*delete)(struct PointSet *);
+    struct PointSetData * data;
+} PointSet;
+
+PointSet * PointSet_new(size_t capacity);
+PointSet * PointSet_from_points(Point ** points, size_t count);
+
+// The loop behind the batch methods, for kernels that work on coordinate arrays directly: write
+// the squared distance from (origin_x, origin_y) to each of count points into out, or the
+// distance itself if take_root is set. Uses AVX2 when the processor has it.
+void PointSet_distance_row(double origin_x, double origin_y, const double * x, const double * y,
+                           size_t count, int take_root, double * out);
+
+#endif
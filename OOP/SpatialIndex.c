@@ -0,0 +1,518 @@
+/*
+ * Program to answer nearest neighbor and radius queries over Points with a k-d tree or a uniform
+ * grid instead of measuring the distance to every Point.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "SpatialIndex.h"
+
+// Ranges of the k-d tree this small are scanned instead of split further.
+#define LEAF_SIZE 16
+// Queries for up to this many neighbors keep their candidates on the stack.
+#define STACK_NEIGHBORS 64
+#define POINTS_PER_CELL 2
+
+// Define the SpatialIndexData struct in SpatialIndex.c so callers can not access it. Coordinates
+// are copied out of the Points into arrays, reordered for the index, and index[i] remembers
+// where the ith of them came from.
+typedef struct SpatialIndexData {
+    double * x;
+    double * y;
+    size_t * index;
+    size_t count;
+    // The grid covers the points from (min_x, min_y) in columns * rows cells. The points of cell
+    // c are stored from cell_start[c] up to cell_start[c + 1].
+    double min_x;
+    double min_y;
+    double cell_size;
+    long columns;
+    long rows;
+    size_t * cell_start;
+} SpatialIndexData;
+
+// The best candidates found so far by a nearest neighbor search, kept as a max-heap on squared
+// distance so the farthest one is on top and can be replaced.
+typedef struct Neighbors {
+    size_t k;
+    size_t count;
+    double * distance2;
+    size_t * index;
+} Neighbors;
+
+// Place a candidate at position of the heap, moving larger children up until it fits.
+static void Neighbors_sift_down(Neighbors * this, size_t position, double distance2,
+                                size_t index) {
+    size_t child;
+    while ((child = 2 * position + 1) < this->count) {
+        if (child + 1 < this->count && this->distance2[child + 1] > this->distance2[child]) {
+            ++child;
+        }
+        if (this->distance2[child] <= distance2) {
+            break;
+        }
+        this->distance2[position] = this->distance2[child];
+        this->index[position] = this->index[child];
+        position = child;
+    }
+    this->distance2[position] = distance2;
+    this->index[position] = index;
+}
+
+// Offer a point to the candidates, keeping it if it is among the k closest seen so far.
+static void Neighbors_offer(Neighbors * this, double distance2, size_t index) {
+    if (this->count < this->k) {
+        // Sift the new candidate up from the bottom of the heap.
+        size_t position = this->count++;
+        while (position > 0 && this->distance2[(position - 1) / 2] < distance2) {
+            this->distance2[position] = this->distance2[(position - 1) / 2];
+            this->index[position] = this->index[(position - 1) / 2];
+            position = (position - 1) / 2;
+        }
+        this->distance2[position] = distance2;
+        this->index[position] = index;
+    } else if (distance2 < this->distance2[0]) {
+        // Replace the farthest candidate.
+        Neighbors_sift_down(this, 0, distance2, index);
+    }
+}
+
+// Obtain the squared distance a point must beat to become a candidate.
+static double Neighbors_bound(Neighbors * this) {
+    return this->count < this->k ? INFINITY : this->distance2[0];
+}
+
+// Copy the candidates into out and distances, closest first, emptying the heap. Returns how many
+// there were.
+static size_t Neighbors_finish(Neighbors * this, size_t * out, double * distances) {
+    size_t found = this->count;
+    while (this->count > 0) {
+        // The top of the heap is the farthest remaining candidate, so it goes last.
+        size_t last = --this->count;
+        out[last] = this->index[0];
+        if (distances) {
+            distances[last] = sqrt(this->distance2[0]);
+        }
+        Neighbors_sift_down(this, 0, this->distance2[last], this->index[last]);
+    }
+    return found;
+}
+
+// Offer every point from start up to end to the candidates.
+static void scan_nearest(SpatialIndexData * data, size_t start, size_t end, double query_x,
+                         double query_y, Neighbors * neighbors) {
+    for (size_t i = start; i < end; i++) {
+        double delta_x = data->x[i] - query_x;
+        double delta_y = data->y[i] - query_y;
+        double distance2 = delta_x * delta_x + delta_y * delta_y;
+        if (distance2 < Neighbors_bound(neighbors)) {
+            Neighbors_offer(neighbors, distance2, data->index[i]);
+        }
+    }
+}
+
+// Store every point from start up to end within radius2 of the query, counting them in found.
+static void scan_within(SpatialIndexData * data, size_t start, size_t end, double query_x,
+                        double query_y, double radius2, size_t * out, double * distances,
+                        size_t max_count, size_t * found) {
+    for (size_t i = start; i < end; i++) {
+        double delta_x = data->x[i] - query_x;
+        double delta_y = data->y[i] - query_y;
+        double distance2 = delta_x * delta_x + delta_y * delta_y;
+        if (distance2 <= radius2) {
+            if (*found < max_count) {
+                out[*found] = data->index[i];
+                if (distances) {
+                    distances[*found] = sqrt(distance2);
+                }
+            }
+            ++*found;
+        }
+    }
+}
+
+// Run a nearest neighbor search with room for k candidates and store the results.
+static size_t nearest_with(SpatialIndex * this, Point * query, size_t k, size_t * out,
+                           double * distances,
+                           void (*search)(SpatialIndexData *, double, double, Neighbors *)) {
+    double stack_distance2[STACK_NEIGHBORS];
+    size_t stack_index[STACK_NEIGHBORS];
+    Neighbors neighbors = {k, 0, stack_distance2, stack_index};
+    if (k > STACK_NEIGHBORS) {
+        neighbors.distance2 = (double *) malloc(k * sizeof(double));
+        neighbors.index = (size_t *) malloc(k * sizeof(size_t));
+    }
+    if (k > 0) {
+        search(this->data, query->x(query), query->y(query), &neighbors);
+    }
+    size_t found = Neighbors_finish(&neighbors, out, distances);
+    if (k > STACK_NEIGHBORS) {
+        free(neighbors.distance2);
+        free(neighbors.index);
+    }
+    return found;
+}
+
+// Swap the points at positions i and j.
+static void swap_points(SpatialIndexData * data, size_t i, size_t j) {
+    double x = data->x[i];
+    double y = data->y[i];
+    size_t index = data->index[i];
+    data->x[i] = data->x[j];
+    data->y[i] = data->y[j];
+    data->index[i] = data->index[j];
+    data->x[j] = x;
+    data->y[j] = y;
+    data->index[j] = index;
+}
+
+// Reorder the points from start up to end so that the one at middle has the median coordinate on
+// axis, with no greater coordinates before it and no smaller ones after it.
+static void select_median(SpatialIndexData * data, size_t start, size_t end, size_t middle,
+                          int axis) {
+    double * coordinates = axis ? data->y : data->x;
+    while (end - start > 1) {
+        // Partition the range into coordinates less than, equal to, and greater than the one in
+        // the middle, like quicksort, and keep going on whichever part holds the median. Keeping
+        // equal coordinates together stops repeated values from making this quadratic.
+        double pivot = coordinates[start + (end - start) / 2];
+        size_t less = start;
+        size_t greater = end;
+        size_t i = start;
+        while (i < greater) {
+            if (coordinates[i] < pivot) {
+                swap_points(data, i++, less++);
+            } else if (coordinates[i] > pivot) {
+                swap_points(data, i, --greater);
+            } else {
+                ++i;
+            }
+        }
+        if (middle < less) {
+            end = less;
+        } else if (middle >= greater) {
+            start = greater;
+        } else {
+            return;
+        }
+    }
+}
+
+// Build the k-d tree over the points from start up to end. The tree is implicit: every range
+// is split at its middle point on x or y, alternating with depth, so a query can find the same
+// splits without any node structs.
+static void build_kd_tree(SpatialIndexData * data, size_t start, size_t end, int axis) {
+    if (end - start <= LEAF_SIZE) {
+        return;
+    }
+    size_t middle = start + (end - start) / 2;
+    select_median(data, start, end, middle, axis);
+    build_kd_tree(data, start, middle, !axis);
+    build_kd_tree(data, middle + 1, end, !axis);
+}
+
+// Search the k-d tree range from start up to end, visiting the side of each split that holds
+// the query first and the other side only if it could hold a closer point.
+static void kd_search(SpatialIndexData * data, size_t start, size_t end, int axis,
+                      double query_x, double query_y, Neighbors * neighbors) {
+    if (end - start <= LEAF_SIZE) {
+        scan_nearest(data, start, end, query_x, query_y, neighbors);
+        return;
+    }
+    size_t middle = start + (end - start) / 2;
+    double delta = axis ? query_y - data->y[middle] : query_x - data->x[middle];
+    scan_nearest(data, middle, middle + 1, query_x, query_y, neighbors);
+    if (delta < 0) {
+        kd_search(data, start, middle, !axis, query_x, query_y, neighbors);
+        if (delta * delta < Neighbors_bound(neighbors)) {
+            kd_search(data, middle + 1, end, !axis, query_x, query_y, neighbors);
+        }
+    } else {
+        kd_search(data, middle + 1, end, !axis, query_x, query_y, neighbors);
+        if (delta * delta < Neighbors_bound(neighbors)) {
+            kd_search(data, start, middle, !axis, query_x, query_y, neighbors);
+        }
+    }
+}
+
+static void kd_search_all(SpatialIndexData * data, double query_x, double query_y,
+                          Neighbors * neighbors) {
+    kd_search(data, 0, data->count, 0, query_x, query_y, neighbors);
+}
+
+// Find the k nearest points to a Point with the k-d tree.
+size_t SpatialIndex_kd_nearest(SpatialIndex * this, Point * query, size_t k, size_t * out,
+                               double * distances) {
+    return nearest_with(this, query, k, out, distances, &kd_search_all);
+}
+
+// Collect the points of the k-d tree range from start up to end within the radius.
+static void kd_within(SpatialIndexData * data, size_t start, size_t end, int axis,
+                      double query_x, double query_y, double radius2, size_t * out,
+                      double * distances, size_t max_count, size_t * found) {
+    if (end - start <= LEAF_SIZE) {
+        scan_within(data, start, end, query_x, query_y, radius2, out, distances, max_count,
+                    found);
+        return;
+    }
+    size_t middle = start + (end - start) / 2;
+    double delta = axis ? query_y - data->y[middle] : query_x - data->x[middle];
+    scan_within(data, middle, middle + 1, query_x, query_y, radius2, out, distances, max_count,
+                found);
+    if (delta <= 0 || delta * delta <= radius2) {
+        kd_within(data, start, middle, !axis, query_x, query_y, radius2, out, distances,
+                  max_count, found);
+    }
+    if (delta >= 0 || delta * delta <= radius2) {
+        kd_within(data, middle + 1, end, !axis, query_x, query_y, radius2, out, distances,
+                  max_count, found);
+    }
+}
+
+// Find the points within radius of a Point with the k-d tree.
+size_t SpatialIndex_kd_within(SpatialIndex * this, Point * query, double radius, size_t * out,
+                              double * distances, size_t max_count) {
+    size_t found = 0;
+    kd_within(this->data, 0, this->data->count, 0, query->x(query), query->y(query),
+              radius * radius, out, distances, max_count, &found);
+    return found;
+}
+
+// Obtain the column or row of the grid cell holding a coordinate, clamped onto the grid.
+static long grid_cell(double coordinate, double min, double cell_size, long cells) {
+    double cell = floor((coordinate - min) / cell_size);
+    if (!(cell >= 0)) {
+        return 0;
+    }
+    return cell >= cells ? cells - 1 : (long) cell;
+}
+
+// Offer the points of every grid cell on the square ring radius cells away from the cell at
+// (column, row) to the candidates.
+static void grid_scan_ring(SpatialIndexData * data, long column, long row, long radius,
+                           double query_x, double query_y, Neighbors * neighbors) {
+    for (long r = row - radius; r <= row + radius; r++) {
+        if (r < 0 || r >= data->rows) {
+            continue;
+        }
+        // Rows at the top and bottom of the ring are scanned whole, the rest only at each end.
+        long step = (r == row - radius || r == row + radius) ? 1 : 2 * radius;
+        for (long c = column - radius; c <= column + radius; c += step) {
+            if (c < 0 || c >= data->columns) {
+                continue;
+            }
+            size_t cell = r * data->columns + c;
+            scan_nearest(data, data->cell_start[cell], data->cell_start[cell + 1], query_x,
+                         query_y, neighbors);
+        }
+    }
+}
+
+// Search rings of grid cells outward from the query's cell. Every point in ring r is at least
+// (r - 1) cells from the query, so the search stops once that is farther than every candidate.
+static void grid_search(SpatialIndexData * data, double query_x, double query_y,
+                        Neighbors * neighbors) {
+    long column = grid_cell(query_x, data->min_x, data->cell_size, data->columns);
+    long row = grid_cell(query_y, data->min_y, data->cell_size, data->rows);
+    long max_radius = data->columns > data->rows ? data->columns : data->rows;
+    for (long radius = 0; radius <= max_radius; radius++) {
+        double reach = (radius - 1) * data->cell_size;
+        if (radius > 0 && reach * reach >= Neighbors_bound(neighbors)) {
+            break;
+        }
+        grid_scan_ring(data, column, row, radius, query_x, query_y, neighbors);
+    }
+}
+
+// Find the k nearest points to a Point with the grid.
+size_t SpatialIndex_grid_nearest(SpatialIndex * this, Point * query, size_t k, size_t * out,
+                                 double * distances) {
+    return nearest_with(this, query, k, out, distances, &grid_search);
+}
+
+// Find the points within radius of a Point with the grid, scanning every cell the square around
+// the circle touches.
+size_t SpatialIndex_grid_within(SpatialIndex * this, Point * query, double radius, size_t * out,
+                                double * distances, size_t max_count) {
+    SpatialIndexData * data = this->data;
+    double query_x = query->x(query);
+    double query_y = query->y(query);
+    long first_column = grid_cell(query_x - radius, data->min_x, data->cell_size, data->columns);
+    long last_column = grid_cell(query_x + radius, data->min_x, data->cell_size, data->columns);
+    long first_row = grid_cell(query_y - radius, data->min_y, data->cell_size, data->rows);
+    long last_row = grid_cell(query_y + radius, data->min_y, data->cell_size, data->rows);
+    size_t found = 0;
+    for (long r = first_row; r <= last_row; r++) {
+        // Cells in a row are stored one after another, so a row of cells is one range of points.
+        size_t start = data->cell_start[r * data->columns + first_column];
+        size_t end = data->cell_start[r * data->columns + last_column + 1];
+        scan_within(data, start, end, query_x, query_y, radius * radius, out, distances,
+                    max_count, &found);
+    }
+    return found;
+}
+
+typedef struct batch_parameters {
+    SpatialIndex * index;
+    Point ** queries;
+    size_t start;
+    size_t end;
+    size_t k;
+    size_t * out;
+    double * distances;
+} batch_parameters;
+
+// Answer the queries from start up to end, padding short results with SIZE_MAX.
+static void * nearest_batch_worker(void * arguments) {
+    batch_parameters * parameters = (batch_parameters *) arguments;
+    size_t k = parameters->k;
+    for (size_t i = parameters->start; i < parameters->end; i++) {
+        size_t * out = parameters->out + i * k;
+        double * distances = parameters->distances ? parameters->distances + i * k : NULL;
+        size_t found = parameters->index->nearest(parameters->index, parameters->queries[i], k,
+                                                  out, distances);
+        for (; found < k; found++) {
+            out[found] = SIZE_MAX;
+            if (distances) {
+                distances[found] = INFINITY;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Split the queries evenly across threads and wait for all of them.
+void SpatialIndex_nearest_batch(SpatialIndex * this, Point ** queries, size_t count, size_t k,
+                                size_t * out, double * distances, int threads) {
+    if (threads <= 0) {
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    pthread_t * workers = (pthread_t *) malloc(threads * sizeof(pthread_t));
+    batch_parameters * parameters = (batch_parameters *) malloc(threads *
+                                                                sizeof(batch_parameters));
+    for (int t = 0; t < threads; t++) {
+        parameters[t] = (batch_parameters) {this, queries, count * t / threads,
+                                            count * (t + 1) / threads, k, out, distances};
+        pthread_create(&workers[t], NULL, &nearest_batch_worker, &parameters[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+    free(parameters);
+}
+
+// Free memory in the heap associated with a SpatialIndex.
+void SpatialIndex_delete(SpatialIndex * this) {
+    free(this->data->x);
+    free(this->data->y);
+    free(this->data->index);
+    free(this->data->cell_start);
+    free(this->data);
+    free(this);
+}
+
+// Declare a SpatialIndex object in the heap holding copies of the coordinates of count Points.
+static SpatialIndex * SpatialIndex_new(Point ** points, size_t count) {
+    SpatialIndex * newSpatialIndex = (SpatialIndex *) malloc(sizeof(SpatialIndex));
+    SpatialIndexData * data = (SpatialIndexData *) calloc(1, sizeof(SpatialIndexData));
+    data->x = (double *) malloc(count * sizeof(double));
+    data->y = (double *) malloc(count * sizeof(double));
+    data->index = (size_t *) malloc(count * sizeof(size_t));
+    data->count = count;
+    for (size_t i = 0; i < count; i++) {
+        data->x[i] = points[i]->x(points[i]);
+        data->y[i] = points[i]->y(points[i]);
+        data->index[i] = i;
+    }
+    newSpatialIndex->data = data;
+    newSpatialIndex->nearest_batch = &SpatialIndex_nearest_batch;
+    newSpatialIndex->delete = &SpatialIndex_delete;
+    return newSpatialIndex;
+}
+
+// Declare a SpatialIndex object in the heap that searches a k-d tree.
+SpatialIndex * SpatialIndex_new_kd_tree(Point ** points, size_t count) {
+    SpatialIndex * newSpatialIndex = SpatialIndex_new(points, count);
+    build_kd_tree(newSpatialIndex->data, 0, count, 0);
+    newSpatialIndex->nearest = &SpatialIndex_kd_nearest;
+    newSpatialIndex->within = &SpatialIndex_kd_within;
+    return newSpatialIndex;
+}
+
+// Declare a SpatialIndex object in the heap that searches a uniform grid. The points are sorted
+// by cell with a counting sort, so each cell's points sit together in the coordinate arrays.
+SpatialIndex * SpatialIndex_new_grid(Point ** points, size_t count, double cell_size) {
+    SpatialIndex * newSpatialIndex = SpatialIndex_new(points, count);
+    SpatialIndexData * data = newSpatialIndex->data;
+    double max_x = count > 0 ? data->x[0] : 0;
+    double max_y = count > 0 ? data->y[0] : 0;
+    data->min_x = max_x;
+    data->min_y = max_y;
+    for (size_t i = 1; i < count; i++) {
+        data->min_x = fmin(data->min_x, data->x[i]);
+        data->min_y = fmin(data->min_y, data->y[i]);
+        max_x = fmax(max_x, data->x[i]);
+        max_y = fmax(max_y, data->y[i]);
+    }
+    double width = max_x - data->min_x;
+    double height = max_y - data->min_y;
+    if (!(cell_size > 0)) {
+        cell_size = sqrt(width * height * POINTS_PER_CELL / (count > 0 ? count : 1));
+    }
+    // Never use more cells than points, which also covers points that all lie on a line.
+    double longest = width > height ? width : height;
+    if (!(cell_size > 0) || (width / cell_size + 1) * (height / cell_size + 1) > count + 1) {
+        cell_size = longest > 0 ? longest / ceil(sqrt(count + 1)) : 1;
+    }
+    data->cell_size = cell_size;
+    data->columns = (long) (width / cell_size) + 1;
+    data->rows = (long) (height / cell_size) + 1;
+
+    size_t cells = data->columns * data->rows;
+    size_t * cell_of = (size_t *) malloc(count * sizeof(size_t));
+    data->cell_start = (size_t *) calloc(cells + 1, sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        long column = grid_cell(data->x[i], data->min_x, cell_size, data->columns);
+        long row = grid_cell(data->y[i], data->min_y, cell_size, data->rows);
+        cell_of[i] = row * data->columns + column;
+        ++data->cell_start[cell_of[i] + 1];
+    }
+    for (size_t c = 0; c < cells; c++) {
+        data->cell_start[c + 1] += data->cell_start[c];
+    }
+
+    // Place each point after the ones already placed in its cell.
+    double * x = (double *) malloc(count * sizeof(double));
+    double * y = (double *) malloc(count * sizeof(double));
+    size_t * index = (size_t *) malloc(count * sizeof(size_t));
+    size_t * next = (size_t *) malloc(cells * sizeof(size_t));
+    for (size_t c = 0; c < cells; c++) {
+        next[c] = data->cell_start[c];
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t position = next[cell_of[i]]++;
+        x[position] = data->x[i];
+        y[position] = data->y[i];
+        index[position] = data->index[i];
+    }
+    free(data->x);
+    free(data->y);
+    free(data->index);
+    free(cell_of);
+    free(next);
+    data->x = x;
+    data->y = y;
+    data->index = index;
+
+    newSpatialIndex->nearest = &SpatialIndex_grid_nearest;
+    newSpatialIndex->within = &SpatialIndex_grid_within;
+    return newSpatialIndex;
+}
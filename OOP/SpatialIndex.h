@@ -0,0 +1,34 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <stddef.h>
+#include "Point.h"
+
+// An index over a fixed set of Points for proximity queries. Results are positions in the array
+// of Points the index was built from. distances may be NULL; otherwise it receives the distance
+// to each result.
+typedef struct SpatialIndex {
+    // Find the k nearest points to a Point, closest first, and return how many were found.
+    size_t (*nearest)(struct SpatialIndex *, Point *, size_t k, size_t * out,
+                      double * distances);
+    // Find the points no farther than radius from a Point, in no particular order. Returns how
+    // many there are, but only stores the first max_count.
+    size_t (*within)(struct SpatialIndex *, Point *, double radius, size_t * out,
+                     double * distances, size_t max_count);
+    // Run nearest for count Points split across threads, or one per processor if threads is 0.
+    // The results for the ith Point start at out + i * k; missing results are set to SIZE_MAX.
+    void (*nearest_batch)(struct SpatialIndex *, Point ** queries, size_t count, size_t k,
+                          size_t * out, double * distances, int threads);
+    void (*delete)(struct SpatialIndex *);
+    struct SpatialIndexData * data;
+} SpatialIndex;
+
+// A k-d tree built in one pass over all the points. Suits any distribution of points.
+SpatialIndex * SpatialIndex_new_kd_tree(Point ** points, size_t count);
+
+// A uniform grid of square cells cell_size wide, or sized for about two points per cell if
+// cell_size is 0. Cells are widened if needed so there are no more cells than points. Faster
+// than the k-d tree when the points are spread evenly.
+SpatialIndex * SpatialIndex_new_grid(Point ** points, size_t count, double cell_size);
+
+#endif
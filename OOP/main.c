@@ -1,6 +1,15 @@
+/*
+ * Program to demonstrate Points, PointSets, and DistanceMatrices.
+ * Compile with: gcc main.c Point.c PointSet.c DistanceMatrix.c "../Floating Point/float_format.c"
+ *     -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include "Point.h"
+#include "PointSet.h"
+#include "DistanceMatrix.h"
 
 int main(void) {
     Point * p1 = Point_new(3.0, 3.0);
@@ -12,6 +21,36 @@ int main(void) {
     printf("Distance from p1 to p2: %.2f\n", p1->distance(p1, p2));
     printf("Distance from p2 to p1: %.2f\n", p2->distance(p2, p1));
     printf("Distance from p1 to itself: %.2f\n", p1->distance(p1, p1));
+
+    // Measure the same points in one batch through a PointSet.
+    Point * points[] = {p1, p2};
+    PointSet * set = PointSet_from_points(points, 2);
+    double magnitudes[2];
+    double distances[2];
+    set->magnitudes(set, magnitudes);
+    set->distances_to(set, p1, distances);
+    for (size_t i = 0; i < set->size(set); i++) {
+        printf("Point %zu of the set: magnitude %.2f, distance to p1 %.2f\n", i, magnitudes[i],
+               distances[i]);
+    }
+
+    // Compute the distances between every pair of points in the set at once.
+    DistanceMatrix * matrix = DistanceMatrix_new(set, 1, 0);
+    printf("Distance from point 0 to point 1 of the set: %.2f\n", matrix->get(matrix, 0, 1));
+    matrix->delete(matrix);
+    set->delete(set);
+
+    // Create points in bulk from a pool; deleting the pool frees all of them.
+    double xs[] = {0.0, 1.0, 2.0};
+    double ys[] = {0.0, 1.0, 4.0};
+    Point * pooled[3];
+    PointPool * pool = PointPool_new(0);
+    pool->new_points(pool, xs, ys, 3, pooled);
+    for (size_t i = 0; i < 3; i++) {
+        printf("Pooled point %zu: %s\n", i, pooled[i]->to_string(pooled[i]));
+    }
+    pool->delete(pool);
+
     p2->delete(p2);
     p1->delete(p1);
     return EXIT_SUCCESS;
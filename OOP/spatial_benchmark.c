@@ -0,0 +1,159 @@
+/*
+ * Program to compare nearest neighbor and radius queries through a SpatialIndex against measuring
+ * the distance to every Point, and to check that both give the same answers.
+ * Format: ./spatial_benchmark [points [queries [k]]]
+ * Compile with: gcc -O2 spatial_benchmark.c SpatialIndex.c Point.c
+ *     "../Floating Point/float_format.c" -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Point.h"
+#include "SpatialIndex.h"
+
+#define DEFAULT_POINTS 200000
+#define DEFAULT_QUERIES 1000
+#define DEFAULT_K 8
+#define COORDINATE_RANGE 1000.0
+// Radius queries are sized to find about this many points each on average.
+#define RADIUS_POINTS 20
+
+// Obtain the current time in seconds.
+double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Find the k nearest points to a query by measuring the distance to every one of them, keeping
+// the closest k sorted by insertion.
+void brute_force_nearest(Point ** points, size_t count, Point * query, size_t k,
+                         double * distances) {
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        double distance = query->distance(query, points[i]);
+        if (found == k && distance >= distances[k - 1]) {
+            continue;
+        }
+        size_t position = found < k ? found++ : k - 1;
+        while (position > 0 && distances[position - 1] > distance) {
+            distances[position] = distances[position - 1];
+            --position;
+        }
+        distances[position] = distance;
+    }
+}
+
+// Count the points within radius of a query by measuring the distance to every one of them.
+size_t brute_force_within(Point ** points, size_t count, Point * query, double radius) {
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (query->distance(query, points[i]) <= radius) {
+            ++found;
+        }
+    }
+    return found;
+}
+
+// Time k nearest neighbor and radius queries through an index, checking every answer against
+// the brute force results, and then time the nearest neighbor queries as one parallel batch.
+void benchmark_index(const char * name, SpatialIndex * index, Point ** queries, size_t query_count,
+                     size_t k, double radius, double * expected_distances,
+                     size_t * expected_within, double brute_force_seconds) {
+    size_t * out = (size_t *) malloc(query_count * k * sizeof(size_t));
+    double * distances = (double *) malloc(query_count * k * sizeof(double));
+    size_t mismatches = 0;
+
+    double start = now();
+    for (size_t q = 0; q < query_count; q++) {
+        index->nearest(index, queries[q], k, out + q * k, distances + q * k);
+    }
+    double nearest_seconds = now() - start;
+
+    start = now();
+    for (size_t q = 0; q < query_count; q++) {
+        // Only the count is checked, so no results need to be stored.
+        if (index->within(index, queries[q], radius, NULL, NULL, 0) != expected_within[q]) {
+            ++mismatches;
+        }
+    }
+    double within_seconds = now() - start;
+
+    for (size_t i = 0; i < query_count * k; i++) {
+        if (distances[i] != expected_distances[i]) {
+            ++mismatches;
+        }
+    }
+
+    start = now();
+    index->nearest_batch(index, queries, query_count, k, out, distances, 0);
+    double batch_seconds = now() - start;
+
+    printf("%-8s nearest %10.2lf us/query (%.0lfx)  within %10.2lf us/query  batch %10.2lf us/query"
+           "  %s\n", name, nearest_seconds * 1e6 / query_count,
+           brute_force_seconds / nearest_seconds, within_seconds * 1e6 / query_count,
+           batch_seconds * 1e6 / query_count, mismatches == 0 ? "ok" : "MISMATCH");
+    free(out);
+    free(distances);
+}
+
+int main(int argc, char * argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_POINTS;
+    size_t query_count = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_QUERIES;
+    size_t k = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_K;
+    if (argc > 4 || count == 0 || query_count == 0 || k == 0 || k > count) {
+        printf("Format: ./spatial_benchmark [points [queries [k]]]\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    PointPool * pool = PointPool_new(count + query_count);
+    Point ** points = (Point **) malloc(count * sizeof(Point *));
+    Point ** queries = (Point **) malloc(query_count * sizeof(Point *));
+    for (size_t i = 0; i < count; i++) {
+        points[i] = pool->new_point(pool, COORDINATE_RANGE * rand() / RAND_MAX,
+                                    COORDINATE_RANGE * rand() / RAND_MAX);
+    }
+    for (size_t q = 0; q < query_count; q++) {
+        queries[q] = pool->new_point(pool, COORDINATE_RANGE * rand() / RAND_MAX,
+                                     COORDINATE_RANGE * rand() / RAND_MAX);
+    }
+    double radius = COORDINATE_RANGE * sqrt(RADIUS_POINTS / (M_PI * count));
+
+    double * expected_distances = (double *) malloc(query_count * k * sizeof(double));
+    size_t * expected_within = (size_t *) malloc(query_count * sizeof(size_t));
+    double start = now();
+    for (size_t q = 0; q < query_count; q++) {
+        brute_force_nearest(points, count, queries[q], k, expected_distances + q * k);
+    }
+    double brute_force_seconds = now() - start;
+    for (size_t q = 0; q < query_count; q++) {
+        expected_within[q] = brute_force_within(points, count, queries[q], radius);
+    }
+    printf("%zu points, %zu queries, k = %zu, radius = %.3lf\n", count, query_count, k, radius);
+    printf("%-8s nearest %10.2lf us/query\n", "brute", brute_force_seconds * 1e6 / query_count);
+
+    start = now();
+    SpatialIndex * kd_tree = SpatialIndex_new_kd_tree(points, count);
+    printf("k-d tree built in %.3lf seconds\n", now() - start);
+    benchmark_index("kd-tree", kd_tree, queries, query_count, k, radius, expected_distances,
+                    expected_within, brute_force_seconds);
+    kd_tree->delete(kd_tree);
+
+    start = now();
+    SpatialIndex * grid = SpatialIndex_new_grid(points, count, 0);
+    printf("grid built in %.3lf seconds\n", now() - start);
+    benchmark_index("grid", grid, queries, query_count, k, radius, expected_distances,
+                    expected_within, brute_force_seconds);
+    grid->delete(grid);
+
+    free(expected_distances);
+    free(expected_within);
+    free(points);
+    free(queries);
+    pool->delete(pool);
+    return EXIT_SUCCESS;
+}
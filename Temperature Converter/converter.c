@@ -1,8 +1,10 @@
 /*
+ * Compile with: gcc converter.c "../Floating Point/float_format.c" -lm
  * Author: Neo Zhou - zhouaea@bc.edu
 */
 #include <stdlib.h>
 #include <stdio.h>
+#include "../Floating Point/float_format.h"
 
 double convert(double temperature_celsius)
 {
@@ -19,6 +21,10 @@ int main(int argc, char** argv)
 
     double celsius = strtod(argv[1], NULL);
     double farenheit = convert(celsius);
-    printf("%.2f degrees celsius is %.2f degrees farenheit", celsius, farenheit);
+    char celsius_text[FORMAT_FIXED_SIZE(2)];
+    char farenheit_text[FORMAT_FIXED_SIZE(2)];
+    format_fixed(celsius_text, celsius, 2);
+    format_fixed(farenheit_text, farenheit, 2);
+    printf("%s degrees celsius is %s degrees farenheit", celsius_text, farenheit_text);
     return 0;
 }
@@ -1,10 +1,12 @@
 /*
+ * Compile with: gcc toggleable_converter.c "../Floating Point/float_format.c" -lm
  * Author: Neo Zhou - zhouaea@bc.edu
 */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "../Floating Point/float_format.h"
 #define ERROR (1)
 #define SUCCESS (0)
 #define TRUE (1)
@@ -147,13 +149,18 @@ void print_usage()
  * If scale is 'F', print the results in the reverse order.
  * Handle the unlikely case of any other character in scale by printing an "internal" error message
  * (meant for the developer) and return without further action.
+ * The temperatures are formatted to two decimals by format_fixed, which matches printf's "%.2f".
 */
 void print_output(double celsius, double fahrenheit, char scale)
 {
+    char celsius_text[FORMAT_FIXED_SIZE(2)];
+    char fahrenheit_text[FORMAT_FIXED_SIZE(2)];
+    format_fixed(celsius_text, celsius, 2);
+    format_fixed(fahrenheit_text, fahrenheit, 2);
     if (scale == 'C')
-        printf("Celsisus: %.2f Fahrenheit: %.2f\n", celsius, fahrenheit);
+        printf("Celsisus: %s Fahrenheit: %s\n", celsius_text, fahrenheit_text);
     else if (scale == 'F')
-        printf("Fahrenheit: %.2f Celsisus: %.2f\n", fahrenheit, celsius);
+        printf("Fahrenheit: %s Celsisus: %s\n", fahrenheit_text, celsius_text);
     else
         fprintf(stderr, "%c is not a valid scale!\n", scale);
         exit(EXIT_FAILURE);
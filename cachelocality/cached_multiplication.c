@@ -0,0 +1,109 @@
+/*
+ * Program to multiply the same square matrices repeatedly through the product cache and compare
+ * cached products against computing them every time.
+ * Compile with:
+ *     gcc cached_multiplication.c ../matrix/matrix.c ../matrix/kernels.c ../matrix/allocator.c
+ *     ../matrix/product_cache.c -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../matrix/matrix.h"
+#include "../matrix/product_cache.h"
+
+#define PAIR_COUNT 4
+#define REQUEST_COUNT 32
+
+/*
+ * Randomly generate a few pairs of n x n matrices and request their products in a random order,
+ * once through a cache that can hold only half of them and once without a cache.
+ */
+void run(int n, char * spill_directory) {
+    int * A[PAIR_COUNT];
+    int * B[PAIR_COUNT];
+    int * expected[PAIR_COUNT];
+    for (int p = 0; p < PAIR_COUNT; p++) {
+        A[p] = (int *) malloc(n * n * sizeof(int));
+        B[p] = (int *) malloc(n * n * sizeof(int));
+        expected[p] = (int *) malloc(n * n * sizeof(int));
+        initialize_matrix(n, A[p]);
+        initialize_matrix(n, B[p]);
+        multiply_standard(n, A[p], B[p], expected[p]);
+    }
+    int requests[REQUEST_COUNT];
+    for (int r = 0; r < REQUEST_COUNT; r++) {
+        requests[r] = rand() % PAIR_COUNT;
+    }
+    int * C = (int *) malloc(n * n * sizeof(int));
+
+    clock_t start;
+    clock_t end;
+    int same = 1;
+
+    // Compute every requested product from scratch.
+    start = clock();
+    for (int r = 0; r < REQUEST_COUNT; r++) {
+        multiply_standard(n, A[requests[r]], B[requests[r]], C);
+    }
+    end = clock();
+    double cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
+    printf("Time elapsed after %i uncached multiplications: %lf seconds\n\n", REQUEST_COUNT,
+           cpu_time_used);
+
+    // Request the same products through a cache with room for half of the distinct products.
+    long max_bytes = (long) (PAIR_COUNT / 2) * n * n * sizeof(int);
+    product_cache * cache = product_cache_new(max_bytes, spill_directory);
+    start = clock();
+    for (int r = 0; r < REQUEST_COUNT; r++) {
+        product_cache_multiply(cache, multiply_standard, n, A[requests[r]], B[requests[r]], C);
+        same = same && matrices_equal(n, C, expected[requests[r]]);
+    }
+    end = clock();
+    cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
+    printf("Time elapsed after %i cached multiplications: %lf seconds\n", REQUEST_COUNT,
+           cpu_time_used);
+    product_cache_print_stats(cache);
+    printf("\n");
+
+    // Time a single hit on its own, which should cost one hash pass over A and B.
+    product_cache_multiply(cache, multiply_standard, n, A[requests[0]], B[requests[0]], C);
+    start = clock();
+    product_cache_multiply(cache, multiply_standard, n, A[requests[0]], B[requests[0]], C);
+    end = clock();
+    printf("Time elapsed after one cache hit: %lf seconds\n\n",
+           ((double) (end - start)) / CLOCKS_PER_SEC);
+
+    printf(same ? "RESULTS ARE THE SAME\n" : "RESULTS ARE NOT THE SAME\n");
+
+    product_cache_delete(cache);
+    for (int p = 0; p < PAIR_COUNT; p++) {
+        free(A[p]);
+        free(B[p]);
+        free(expected[p]);
+    }
+    free(C);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2 && argc != 3) {
+        printf("Format: ./cached_multiplication base_2_exponent [spill_directory]\n");
+        return 1;
+    }
+
+    // Ensure the maximum value of n is 1024 and the minimum value of n is 1.
+    int power = atoi(argv[1]);
+    if (power < 0 || power > 10) {
+        printf("Please input an exponent between 0 and 10");
+        return 1;
+    }
+
+    int n = pow(2, power);
+
+    printf("n = %i\n", n);
+    run(n, argc == 3 ? argv[2] : NULL);
+
+    return 0;
+}
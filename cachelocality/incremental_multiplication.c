@@ -0,0 +1,393 @@
+/*
+ * Program to keep the product of two square matrices current while entries, rows, and columns
+ * of the factors are updated, instead of recomputing the whole product after every change.
+ * Compile with:
+ *     gcc incremental_multiplication.c ../matrix/matrix.c ../matrix/kernels.c
+ *     ../matrix/allocator.c ../matrix/product_cache.c -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../matrix/matrix.h"
+
+/*
+ * Which factor of the product an update is applied to.
+ */
+typedef enum update_target {
+    UPDATE_A,
+    UPDATE_B
+} update_target;
+
+/*
+ * The shape of an update. An entry update replaces a single value, a row or column update
+ * replaces n values at once.
+ */
+typedef enum update_kind {
+    UPDATE_ENTRY,
+    UPDATE_ROW,
+    UPDATE_COLUMN
+} update_kind;
+
+/*
+ * A single change to A or B. For an entry update, row and column locate the entry and value is
+ * its new value. For a row update only row is used, for a column update only column is used, and
+ * values points to the n new entries of that row or column.
+ */
+typedef struct matrix_update {
+    update_target target;
+    update_kind kind;
+    int row;
+    int column;
+    int value;
+    int * values;
+} matrix_update;
+
+/*
+ * Two factors and their product, which is kept equal to A x B by every update.
+ */
+typedef struct incremental_product {
+    int n;
+    int * A;
+    int * B;
+    int * C;
+    int * delta;
+} incremental_product;
+
+/*
+ * Take ownership of A and B, allocate C, and compute the initial product with a full multiply.
+ */
+incremental_product * incremental_product_new(int n, int * A, int * B) {
+    incremental_product * product = (incremental_product *) malloc(sizeof(incremental_product));
+    product->n = n;
+    product->A = A;
+    product->B = B;
+    product->C = (int *) malloc(n * n * sizeof(int));
+    product->delta = (int *) malloc(n * sizeof(int));
+    multiply_standard(n, A, B, product->C);
+    return product;
+}
+
+/*
+ * Free the factors, the product, and the scratch space of an incremental product.
+ */
+void incremental_product_delete(incremental_product * product) {
+    free(product->A);
+    free(product->B);
+    free(product->C);
+    free(product->delta);
+    free(product);
+}
+
+/*
+ * Replace A[i][k]. Only row i of C depends on it: C[i][j] changes by delta * B[k][j]. O(n).
+ */
+void update_entry_of_A(incremental_product * product, int i, int k, int value) {
+    int n = product->n;
+    int delta = value - product->A[i * n + k];
+    product->A[i * n + k] = value;
+    if (delta == 0) {
+        return;
+    }
+    int * B_row = product->B + k * n;
+    int * C_row = product->C + i * n;
+    for (int j = 0; j < n; j++) {
+        C_row[j] += delta * B_row[j];
+    }
+}
+
+/*
+ * Replace B[k][j]. Only column j of C depends on it: C[i][j] changes by A[i][k] * delta. O(n).
+ */
+void update_entry_of_B(incremental_product * product, int k, int j, int value) {
+    int n = product->n;
+    int delta = value - product->B[k * n + j];
+    product->B[k * n + j] = value;
+    if (delta == 0) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        product->C[i * n + j] += product->A[i * n + k] * delta;
+    }
+}
+
+/*
+ * Replace row i of A. Row i of C changes by the row vector delta x B, which is the rank-1 update
+ * e_i (delta x B) of C. O(n^2).
+ */
+void update_row_of_A(incremental_product * product, int i, int * values) {
+    int n = product->n;
+    int * delta = product->delta;
+    int * C_row = product->C + i * n;
+    for (int k = 0; k < n; k++) {
+        delta[k] = values[k] - product->A[i * n + k];
+        product->A[i * n + k] = values[k];
+    }
+    // Walk B row by row so that every inner loop is a sequential pass.
+    for (int k = 0; k < n; k++) {
+        if (delta[k] == 0) {
+            continue;
+        }
+        int * B_row = product->B + k * n;
+        for (int j = 0; j < n; j++) {
+            C_row[j] += delta[k] * B_row[j];
+        }
+    }
+}
+
+/*
+ * Replace column k of A. C changes by the outer product of the column delta with row k of B,
+ * a rank-1 update. O(n^2).
+ */
+void update_column_of_A(incremental_product * product, int k, int * values) {
+    int n = product->n;
+    int * delta = product->delta;
+    int * B_row = product->B + k * n;
+    for (int i = 0; i < n; i++) {
+        delta[i] = values[i] - product->A[i * n + k];
+        product->A[i * n + k] = values[i];
+    }
+    for (int i = 0; i < n; i++) {
+        if (delta[i] == 0) {
+            continue;
+        }
+        int * C_row = product->C + i * n;
+        for (int j = 0; j < n; j++) {
+            C_row[j] += delta[i] * B_row[j];
+        }
+    }
+}
+
+/*
+ * Replace row k of B. C changes by the outer product of column k of A with the row delta,
+ * a rank-1 update. O(n^2).
+ */
+void update_row_of_B(incremental_product * product, int k, int * values) {
+    int n = product->n;
+    int * delta = product->delta;
+    for (int j = 0; j < n; j++) {
+        delta[j] = values[j] - product->B[k * n + j];
+        product->B[k * n + j] = values[j];
+    }
+    for (int i = 0; i < n; i++) {
+        int a = product->A[i * n + k];
+        if (a == 0) {
+            continue;
+        }
+        int * C_row = product->C + i * n;
+        for (int j = 0; j < n; j++) {
+            C_row[j] += a * delta[j];
+        }
+    }
+}
+
+/*
+ * Replace column j of B. Column j of C changes by A x delta, which is the rank-1 update
+ * (A x delta) e_j of C. O(n^2).
+ */
+void update_column_of_B(incremental_product * product, int j, int * values) {
+    int n = product->n;
+    int * delta = product->delta;
+    for (int k = 0; k < n; k++) {
+        delta[k] = values[k] - product->B[k * n + j];
+        product->B[k * n + j] = values[k];
+    }
+    for (int i = 0; i < n; i++) {
+        int * A_row = product->A + i * n;
+        int c_entry = 0;
+        for (int k = 0; k < n; k++) {
+            c_entry += A_row[k] * delta[k];
+        }
+        product->C[i * n + j] += c_entry;
+    }
+}
+
+/*
+ * Estimate how many multiply-adds an update costs when applied incrementally.
+ */
+long update_cost(int n, matrix_update * update) {
+    return update->kind == UPDATE_ENTRY ? (long) n : (long) n * n;
+}
+
+/*
+ * Overwrite A or B with an update without touching C. Used when a batch is cheaper to apply by
+ * recomputing the product from scratch.
+ */
+void write_update(incremental_product * product, matrix_update * update) {
+    int n = product->n;
+    int * matrix = update->target == UPDATE_A ? product->A : product->B;
+    switch (update->kind) {
+        case UPDATE_ENTRY:
+            matrix[update->row * n + update->column] = update->value;
+            break;
+        case UPDATE_ROW:
+            memcpy(matrix + update->row * n, update->values, n * sizeof(int));
+            break;
+        case UPDATE_COLUMN:
+            for (int i = 0; i < n; i++) {
+                matrix[i * n + update->column] = update->values[i];
+            }
+            break;
+    }
+}
+
+/*
+ * Apply a single update to A or B and patch C so that it stays equal to A x B.
+ */
+void apply_update(incremental_product * product, matrix_update * update) {
+    if (update->target == UPDATE_A) {
+        switch (update->kind) {
+            case UPDATE_ENTRY:
+                update_entry_of_A(product, update->row, update->column, update->value);
+                break;
+            case UPDATE_ROW:
+                update_row_of_A(product, update->row, update->values);
+                break;
+            case UPDATE_COLUMN:
+                update_column_of_A(product, update->column, update->values);
+                break;
+        }
+    } else {
+        switch (update->kind) {
+            case UPDATE_ENTRY:
+                update_entry_of_B(product, update->row, update->column, update->value);
+                break;
+            case UPDATE_ROW:
+                update_row_of_B(product, update->row, update->values);
+                break;
+            case UPDATE_COLUMN:
+                update_column_of_B(product, update->column, update->values);
+                break;
+        }
+    }
+}
+
+/*
+ * Apply a batch of updates in order and keep C current. If patching would cost more than a full
+ * n^3 multiply, write all updates into A and B and recompute C once instead. Returns 1 if the
+ * batch was applied incrementally and 0 if C was recomputed.
+ */
+int apply_updates(incremental_product * product, matrix_update * updates, int count) {
+    int n = product->n;
+    long full_cost = (long) n * n * n;
+    long incremental_cost = 0;
+    for (int u = 0; u < count && incremental_cost <= full_cost; u++) {
+        incremental_cost += update_cost(n, &updates[u]);
+    }
+
+    if (incremental_cost > full_cost) {
+        for (int u = 0; u < count; u++) {
+            write_update(product, &updates[u]);
+        }
+        multiply_standard(n, product->A, product->B, product->C);
+        return 0;
+    }
+
+    for (int u = 0; u < count; u++) {
+        apply_update(product, &updates[u]);
+    }
+    return 1;
+}
+
+/*
+ * Fill a batch with random entry updates. Every fourth update replaces a whole row or column
+ * when mixed is set, using the n values reserved for it in values.
+ */
+void generate_updates(int n, matrix_update * updates, int count, int * values, int mixed) {
+    for (int u = 0; u < count; u++) {
+        matrix_update * update = &updates[u];
+        update->target = rand() % 2 ? UPDATE_A : UPDATE_B;
+        update->row = rand() % n;
+        update->column = rand() % n;
+        update->value = rand() % 10;
+        update->values = values + u * n;
+        update->kind = UPDATE_ENTRY;
+        if (mixed && u % 4 == 3) {
+            update->kind = rand() % 2 ? UPDATE_ROW : UPDATE_COLUMN;
+            for (int i = 0; i < n; i++) {
+                update->values[i] = rand() % 10;
+            }
+        }
+    }
+}
+
+/*
+ * Compare keeping the product current incrementally against recomputing it after every batch,
+ * for a range of batch sizes.
+ */
+void run(int n) {
+    int * A = (int *) malloc(n * n * sizeof(int));
+    int * B = (int *) malloc(n * n * sizeof(int));
+    initialize_matrix(n, A);
+    initialize_matrix(n, B);
+    incremental_product * product = incremental_product_new(n, A, B);
+
+    int * full = (int *) malloc(n * n * sizeof(int));
+    int max_batch = 4 * n;
+    matrix_update * updates = (matrix_update *) malloc(max_batch * sizeof(matrix_update));
+    int * values = (int *) malloc(max_batch * n * sizeof(int));
+    int queries = 8;
+
+    printf("%10s %8s %14s %14s %10s %8s\n", "updates", "mixed", "incremental", "recompute",
+           "speedup", "result");
+    for (int mixed = 0; mixed <= 1; mixed++) {
+        for (int batch = 1; batch <= max_batch; batch *= 4) {
+            clock_t start;
+            clock_t end;
+            double incremental_time = 0;
+            double recompute_time = 0;
+            int same = 1;
+
+            for (int q = 0; q < queries; q++) {
+                generate_updates(n, updates, batch, values, mixed);
+
+                start = clock();
+                apply_updates(product, updates, batch);
+                end = clock();
+                incremental_time += ((double) (end - start)) / CLOCKS_PER_SEC;
+
+                // The factors already hold the updates, so a full multiply gives the reference.
+                start = clock();
+                multiply_standard(n, product->A, product->B, full);
+                end = clock();
+                recompute_time += ((double) (end - start)) / CLOCKS_PER_SEC;
+
+                same = same && matrices_equal(n, product->C, full);
+            }
+
+            printf("%10i %8s %13lfs %13lfs %9.1lfx %8s\n", batch, mixed ? "yes" : "no",
+                   incremental_time / queries, recompute_time / queries,
+                   incremental_time > 0 ? recompute_time / incremental_time : 0.0,
+                   same ? "SAME" : "DIFFERENT");
+        }
+    }
+
+    free(full);
+    free(updates);
+    free(values);
+    incremental_product_delete(product);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        printf("Format: ./incremental_multiplication base_2_exponent\n");
+        return 1;
+    }
+
+    // Ensure the maximum value of n is 1024 and the minimum value of n is 1.
+    int power = atoi(argv[1]);
+    if (power < 0 || power > 10) {
+        printf("Please input an exponent between 0 and 10");
+        return 1;
+    }
+
+    int n = pow(2, power);
+
+    printf("n = %i\n", n);
+    run(n);
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+/*
+ * Program to multiply a chain of matrices of varying shapes in the cheapest order, chosen by
+ * dynamic programming over all parenthesizations.
+ * Compile with:
+ *     gcc matrix_chain.c ../matrix/matrix.c ../matrix/kernels.c ../matrix/allocator.c
+ *     ../matrix/product_cache.c -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../matrix/matrix.h"
+
+#define MAX_CHAIN 16
+
+/*
+ * The multiplication order of a chain and the buffers used to run it. Matrix i of the chain is
+ * dims[i] x dims[i + 1]. split[i * count + j] is the index after which the product of matrices
+ * i through j is split into a left and right part.
+ */
+typedef struct chain_plan {
+    int count;
+    int * dims;
+    long * cost;
+    int * split;
+    long naive_cost;
+    int buffer_count;
+    int ** buffers;
+    int * transpose_buffer;
+} chain_plan;
+
+/*
+ * Initialize a rows x columns matrix with pseudo-random numbers from 0-9.
+ */
+static void chain_initialize_matrix(int rows, int columns, int * matrix) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < columns; j++) {
+            matrix[i * columns + j] = rand() % 10;
+        }
+    }
+}
+
+/*
+ * Check the corresponding entries of two rows x columns matrices to see if they have the same
+ * values.
+ */
+static void chain_verify(int rows, int columns, int * C, int * D) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < columns; j++) {
+            if (C[i * columns + j] != D[i * columns + j]) {
+                printf("RESULTS ARE NOT THE SAME\n");
+                return;
+            }
+        }
+    }
+    printf("RESULTS ARE THE SAME\n");
+}
+
+/*
+ * Multiply a rows x inner matrix A by an inner x columns matrix B, first transposing B into
+ * scratch to get better spacial locality. This is the transposed kernel from
+ * matrixmultiplication.c generalized to rectangular shapes.
+ */
+static void chain_multiply_transpose(int rows, int inner, int columns, int * A, int * B, int * C,
+                                    int * scratch) {
+    for (int k = 0; k < inner; k++) {
+        for (int j = 0; j < columns; j++) {
+            scratch[j * inner + k] = B[k * columns + j];
+        }
+    }
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < columns; j++) {
+            int c_entry = 0;
+            for (int k = 0; k < inner; k++) {
+                c_entry += A[i * inner + k] * scratch[j * inner + k];
+            }
+            C[i * columns + j] = c_entry;
+        }
+    }
+}
+
+/*
+ * Count the buffers needed to hold intermediate products while running matrices i through j,
+ * given that in_use buffers are already held. Mirrors the order in which run_plan takes buffers
+ * and updates peak with the most held at once.
+ */
+void count_buffers(chain_plan * plan, int i, int j, int in_use, int * peak) {
+    if (i == j) {
+        return;
+    }
+    int s = plan->split[i * plan->count + j];
+    int held = in_use;
+
+    // The left result stays alive while the right side runs.
+    if (s > i) {
+        held++;
+        *peak = held > *peak ? held : *peak;
+        count_buffers(plan, i, s, held, peak);
+    }
+    if (s + 1 < j) {
+        held++;
+        *peak = held > *peak ? held : *peak;
+        count_buffers(plan, s + 1, j, held, peak);
+    }
+}
+
+/*
+ * Choose the cheapest parenthesization of a chain of count matrices, where matrix i is
+ * dims[i] x dims[i + 1], and allocate the intermediate buffers needed to run it.
+ */
+chain_plan * plan_chain(int count, int * dims) {
+    chain_plan * plan = (chain_plan *) malloc(sizeof(chain_plan));
+    plan->count = count;
+    plan->dims = (int *) malloc((count + 1) * sizeof(int));
+    memcpy(plan->dims, dims, (count + 1) * sizeof(int));
+    plan->cost = (long *) calloc(count * count, sizeof(long));
+    plan->split = (int *) calloc(count * count, sizeof(int));
+
+    // Solve for every subchain in order of length, trying each split point and keeping the
+    // one with the fewest scalar multiplications.
+    for (int length = 2; length <= count; length++) {
+        for (int i = 0; i + length - 1 < count; i++) {
+            int j = i + length - 1;
+            plan->cost[i * count + j] = -1;
+            for (int s = i; s < j; s++) {
+                long cost = plan->cost[i * count + s] + plan->cost[(s + 1) * count + j]
+                    + (long) dims[i] * dims[s + 1] * dims[j + 1];
+                if (plan->cost[i * count + j] < 0 || cost < plan->cost[i * count + j]) {
+                    plan->cost[i * count + j] = cost;
+                    plan->split[i * count + j] = s;
+                }
+            }
+        }
+    }
+
+    plan->naive_cost = 0;
+    for (int i = 1; i < count; i++) {
+        plan->naive_cost += (long) dims[0] * dims[i] * dims[i + 1];
+    }
+
+    // Size every buffer for the largest shape any operand or product in the chain can have, so
+    // one set of buffers serves both the planned and the left-to-right order.
+    long max_size = 0;
+    for (int a = 0; a <= count; a++) {
+        for (int b = a + 1; b <= count; b++) {
+            if ((long) dims[a] * dims[b] > max_size) {
+                max_size = (long) dims[a] * dims[b];
+            }
+        }
+    }
+
+    int peak = 0;
+    count_buffers(plan, 0, count - 1, 0, &peak);
+    plan->buffer_count = peak > 2 ? peak : 2;
+    plan->buffers = (int **) malloc(plan->buffer_count * sizeof(int *));
+    for (int b = 0; b < plan->buffer_count; b++) {
+        plan->buffers[b] = (int *) malloc(max_size * sizeof(int));
+    }
+    plan->transpose_buffer = (int *) malloc(max_size * sizeof(int));
+    return plan;
+}
+
+/*
+ * Free a plan and its buffers.
+ */
+void chain_plan_delete(chain_plan * plan) {
+    for (int b = 0; b < plan->buffer_count; b++) {
+        free(plan->buffers[b]);
+    }
+    free(plan->buffers);
+    free(plan->transpose_buffer);
+    free(plan->dims);
+    free(plan->cost);
+    free(plan->split);
+    free(plan);
+}
+
+/*
+ * Print the parenthesization of matrices i through j.
+ */
+void print_plan(chain_plan * plan, int i, int j) {
+    if (i == j) {
+        printf("M%i", i + 1);
+        return;
+    }
+    int s = plan->split[i * plan->count + j];
+    printf("(");
+    print_plan(plan, i, s);
+    printf(" ");
+    print_plan(plan, s + 1, j);
+    printf(")");
+}
+
+/*
+ * Multiply matrices i through j into output following the plan. Intermediate products are
+ * taken from the plan's buffers through a stack of free buffer indices and returned to it as
+ * soon as they have been consumed.
+ */
+void run_plan(chain_plan * plan, int ** matrices, int i, int j, int * output, int * free_buffers,
+              int * free_count) {
+    int s = plan->split[i * plan->count + j];
+    int * left = matrices[i];
+    int * right = matrices[s + 1];
+    int left_buffer = -1;
+    int right_buffer = -1;
+
+    if (s > i) {
+        left_buffer = free_buffers[--*free_count];
+        left = plan->buffers[left_buffer];
+        run_plan(plan, matrices, i, s, left, free_buffers, free_count);
+    }
+    if (s + 1 < j) {
+        right_buffer = free_buffers[--*free_count];
+        right = plan->buffers[right_buffer];
+        run_plan(plan, matrices, s + 1, j, right, free_buffers, free_count);
+    }
+
+    chain_multiply_transpose(plan->dims[i], plan->dims[s + 1], plan->dims[j + 1], left, right,
+                             output, plan->transpose_buffer);
+
+    if (right_buffer >= 0) {
+        free_buffers[(*free_count)++] = right_buffer;
+    }
+    if (left_buffer >= 0) {
+        free_buffers[(*free_count)++] = left_buffer;
+    }
+}
+
+/*
+ * Multiply the whole chain into C in the planned order. C must hold dims[0] x dims[count].
+ */
+void multiply_chain(chain_plan * plan, int ** matrices, int * C) {
+    if (plan->count == 1) {
+        memcpy(C, matrices[0], (long) plan->dims[0] * plan->dims[1] * sizeof(int));
+        return;
+    }
+    int free_buffers[MAX_CHAIN];
+    int free_count = plan->buffer_count;
+    for (int b = 0; b < plan->buffer_count; b++) {
+        free_buffers[b] = b;
+    }
+    run_plan(plan, matrices, 0, plan->count - 1, C, free_buffers, &free_count);
+}
+
+/*
+ * Multiply the whole chain into C from left to right, ping-ponging between two of the plan's
+ * buffers.
+ */
+void multiply_chain_naive(chain_plan * plan, int ** matrices, int * C) {
+    int * dims = plan->dims;
+    int * product = matrices[0];
+    for (int i = 1; i < plan->count; i++) {
+        int * output = i == plan->count - 1 ? C : plan->buffers[i % 2];
+        chain_multiply_transpose(dims[0], dims[i], dims[i + 1], product, matrices[i], output,
+                                 plan->transpose_buffer);
+        product = output;
+    }
+    if (plan->count == 1) {
+        memcpy(C, product, (long) dims[0] * dims[1] * sizeof(int));
+    }
+}
+
+/*
+ * Randomly generate a chain of matrices with the given shapes, multiply them in the planned and
+ * in the left-to-right order, and compare estimated and measured costs.
+ */
+void run(int count, int * dims) {
+    int * matrices[MAX_CHAIN];
+    for (int i = 0; i < count; i++) {
+        matrices[i] = (int *) malloc((long) dims[i] * dims[i + 1] * sizeof(int));
+        chain_initialize_matrix(dims[i], dims[i + 1], matrices[i]);
+    }
+    int * C = (int *) malloc((long) dims[0] * dims[count] * sizeof(int));
+    int * D = (int *) malloc((long) dims[0] * dims[count] * sizeof(int));
+
+    chain_plan * plan = plan_chain(count, dims);
+    printf("Planned order: ");
+    print_plan(plan, 0, count - 1);
+    printf("\nIntermediate buffers: %i\n\n", plan->buffer_count);
+
+    double start = wall_time();
+    multiply_chain(plan, matrices, C);
+    double planned_time = wall_time() - start;
+
+    start = wall_time();
+    multiply_chain_naive(plan, matrices, D);
+    double naive_time = wall_time() - start;
+
+    long planned_cost = count > 1 ? plan->cost[count - 1] : 0;
+    printf("Planned order:       %15li multiplications, %lf seconds\n", planned_cost,
+           planned_time);
+    printf("Left to right order: %15li multiplications, %lf seconds\n", plan->naive_cost,
+           naive_time);
+    if (planned_cost > 0 && planned_time > 0) {
+        printf("Estimated speedup: %.2lfx, measured speedup: %.2lfx\n\n",
+               (double) plan->naive_cost / planned_cost, naive_time / planned_time);
+    }
+
+    chain_verify(dims[0], dims[count], C, D);
+
+    chain_plan_delete(plan);
+    for (int i = 0; i < count; i++) {
+        free(matrices[i]);
+    }
+    free(C);
+    free(D);
+}
+
+int main(int argc, char *argv[]) {
+    // Default to a chain where left to right is far from optimal.
+    int default_dims[] = {512, 8, 512, 16, 512, 4};
+    int dims[MAX_CHAIN + 1];
+    int count;
+
+    if (argc == 1) {
+        count = sizeof(default_dims) / sizeof(int) - 1;
+        memcpy(dims, default_dims, sizeof(default_dims));
+    } else if (argc < 3 || argc - 2 > MAX_CHAIN) {
+        printf("Format: ./matrix_chain d0 d1 ... dk\n"
+               "Multiplies k matrices where matrix i is d(i-1) x d(i), for 1 <= k <= %i.\n",
+               MAX_CHAIN);
+        return 1;
+    } else {
+        count = argc - 2;
+        for (int i = 0; i <= count; i++) {
+            dims[i] = atoi(argv[i + 1]);
+            if (dims[i] < 1 || dims[i] > 4096) {
+                printf("Please input dimensions between 1 and 4096\n");
+                return 1;
+            }
+        }
+    }
+
+    printf("Chain of %i matrices:", count);
+    for (int i = 0; i < count; i++) {
+        printf(" %ix%i", dims[i], dims[i + 1]);
+    }
+    printf("\n");
+    run(count, dims);
+
+    return 0;
+}
@@ -0,0 +1,322 @@
+/*
+ * Program to raise a square matrix to a large power by repeated squaring, reusing a fixed set of
+ * buffers, with optional modular arithmetic to keep entries from overflowing. Without a modulus
+ * the squarings run on a registry kernel, "auto" unless another is named, and entries wrap modulo
+ * 2^32; -fwrapv makes that wrapping defined for the kernels that multiply in plain int.
+ * Compile with: gcc -fwrapv matrix_power.c ../matrix/matrix.c ../matrix/kernels.c
+ *     ../matrix/allocator.c ../matrix/product_cache.c -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../matrix/matrix.h"
+
+// Most scalar multiply-adds, n^3 per product times k products, that the comparison against
+// repeated multiplication may cost. A few seconds of work for the standard kernel.
+#define NAIVE_BUDGET 4e9
+
+/*
+ * Set a matrix to the identity.
+ */
+void identity(int n, int * matrix) {
+    memset(matrix, 0, n * n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        matrix[i * n + i] = 1;
+    }
+}
+
+/*
+ * Multiply two matrices A and B without transposition, reducing every entry modulo modulus.
+ * A modulus of 0 means arithmetic modulo 2^32, done unsigned so that overflow wraps instead of
+ * being undefined. Used as the reference for the fast kernel.
+ */
+void multiply_standard_mod(int n, int * A, int * B, int * C, int modulus) {
+    for (int i = 0; i < n; i++){
+        for (int j = 0; j < n; j++) {
+            if (modulus == 0) {
+                unsigned int c_entry = 0;
+                for (int k = 0; k < n; k++) {
+                    c_entry += (unsigned int) A[i * n + k] * B[k * n + j];
+                }
+                C[i * n + j] = (int) c_entry;
+            } else {
+                long long c_entry = 0;
+                for (int k = 0; k < n; k++) {
+                    c_entry = (c_entry + (long long) A[i * n + k] * B[k * n + j]) % modulus;
+                }
+                C[i * n + j] = (int) c_entry;
+            }
+        }
+    }
+}
+
+/*
+ * Multiply two matrices A and B, first transposing B into scratch to get better spacial
+ * locality, reducing every entry modulo modulus, which must not be 0.
+ *
+ * With a modulus, entries of A and B are below modulus, so each product is at most
+ * (modulus - 1)^2. Products are summed in 64 bits and only reduced once the sum could
+ * overflow, which for small moduli means once per entry.
+ */
+void multiply_transpose_mod(int n, int * A, int * B, int * C, int * scratch, int modulus) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            scratch[j * n + i] = B[i * n + j];
+        }
+    }
+
+    unsigned long long largest = (unsigned long long) (modulus - 1) * (modulus - 1);
+    unsigned long long safe_terms =
+        largest == 0 ? (unsigned long long) n : (ULLONG_MAX - modulus) / largest;
+    int terms_per_reduction = safe_terms < (unsigned long long) n ? (int) safe_terms : n;
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            unsigned long long c_entry = 0;
+            int k = 0;
+            while (k < n) {
+                int end = k + terms_per_reduction < n ? k + terms_per_reduction : n;
+                for (; k < end; k++) {
+                    c_entry += (unsigned long long) A[i * n + k] * scratch[j * n + k];
+                }
+                c_entry %= modulus;
+            }
+            C[i * n + j] = (int) c_entry;
+        }
+    }
+}
+
+/*
+ * The buffers matrix_power works in, allocated once for a size n and reused by every call, and
+ * the registry kernel used for products without a modulus.
+ */
+typedef struct matrix_power_workspace {
+    int n;
+    int * base;
+    int * spare;
+    int * scratch;
+    const matrix_kernel * kernel;
+} matrix_power_workspace;
+
+/*
+ * Release a workspace and its buffers.
+ */
+void matrix_power_workspace_free(matrix_power_workspace * workspace) {
+    if (workspace->base) {
+        free_matrix(workspace->base);
+    }
+    if (workspace->spare) {
+        free_matrix(workspace->spare);
+    }
+    if (workspace->scratch) {
+        free_matrix(workspace->scratch);
+    }
+    free(workspace);
+}
+
+/*
+ * Allocate a workspace for n x n matrices that multiplies through the named registry kernel, or
+ * "auto" for the fastest one the tuning profile knows of. Returns NULL if there is no such kernel
+ * or the buffers do not fit in memory.
+ */
+matrix_power_workspace * matrix_power_workspace_new(int n, const char * kernel_name) {
+    const matrix_kernel * kernel = find_kernel(kernel_name);
+    if (kernel == NULL) {
+        printf("Unknown kernel: %s\n", kernel_name);
+        print_kernels();
+        return NULL;
+    }
+    matrix_power_workspace * workspace =
+        (matrix_power_workspace *) malloc(sizeof(matrix_power_workspace));
+    workspace->n = n;
+    workspace->base = allocate_matrix(n, 0);
+    workspace->spare = allocate_matrix(n, 0);
+    workspace->scratch = allocate_matrix(n, 0);
+    workspace->kernel = kernel;
+    if (workspace->base == NULL || workspace->spare == NULL || workspace->scratch == NULL) {
+        matrix_power_workspace_free(workspace);
+        return NULL;
+    }
+    return workspace;
+}
+
+/*
+ * Multiply A and B into C, which must be neither of them. Without a modulus the product goes
+ * through the workspace's registry kernel; with one, through multiply_transpose_mod, since no
+ * registered kernel reduces as it goes.
+ */
+void multiply_into(matrix_power_workspace * workspace, int * A, int * B, int * C, int modulus) {
+    if (modulus == 0) {
+        workspace->kernel->multiply(workspace->n, A, B, C);
+    } else {
+        multiply_transpose_mod(workspace->n, A, B, C, workspace->scratch, modulus);
+    }
+}
+
+/*
+ * Compute A^k into result by exponentiation by squaring, reducing modulo modulus unless it is 0.
+ * workspace must have been allocated for the same n.
+ *
+ * The running result and the running square of A each ping-pong with a single spare buffer:
+ * every multiply writes into the spare, which then swaps roles with its input. The buffers all
+ * come from the workspace, so repeated calls allocate nothing.
+ */
+void matrix_power(int n, int * A, int k, int modulus, int * result,
+                  matrix_power_workspace * workspace) {
+    int * base = workspace->base;
+    int * spare = workspace->spare;
+    int * product = result;
+
+    for (int i = 0; i < n * n; i++) {
+        base[i] = modulus == 0 ? A[i] : (int) (((long long) A[i] % modulus + modulus) % modulus);
+    }
+    identity(n, product);
+    if (modulus == 1) {
+        memset(product, 0, n * n * sizeof(int));
+    }
+
+    // Skip multiplying by the identity for the lowest set bit of k.
+    int product_is_identity = 1;
+    int * temp;
+    while (k > 0) {
+        if (k & 1) {
+            if (product_is_identity) {
+                memcpy(product, base, n * n * sizeof(int));
+                product_is_identity = 0;
+            } else {
+                multiply_into(workspace, product, base, spare, modulus);
+                temp = product;
+                product = spare;
+                spare = temp;
+            }
+        }
+        k >>= 1;
+        if (k > 0) {
+            multiply_into(workspace, base, base, spare, modulus);
+            temp = base;
+            base = spare;
+            spare = temp;
+        }
+    }
+
+    // The result may have ended up in one of the working buffers. Move it out, and hand the
+    // workspace back the two buffers that are not the caller's.
+    if (product != result) {
+        memcpy(result, product, n * n * sizeof(int));
+        if (base == result) {
+            base = product;
+        } else {
+            spare = product;
+        }
+    }
+    workspace->base = base;
+    workspace->spare = spare;
+}
+
+/*
+ * Compute A^k the way a caller of the plain multiply would: starting from the identity, k
+ * standard multiplies, each into a freshly allocated matrix.
+ */
+void matrix_power_naive(int n, int * A, int k, int modulus, int * result) {
+    int * product = (int *) malloc(n * n * sizeof(int));
+    identity(n, product);
+    for (int i = 0; i < k; i++) {
+        int * next = (int *) malloc(n * n * sizeof(int));
+        multiply_standard_mod(n, product, A, next, modulus);
+        free(product);
+        product = next;
+    }
+    memcpy(result, product, n * n * sizeof(int));
+    free(product);
+}
+
+/*
+ * Randomly generate an n x n matrix, raise it to the kth power by squaring and, within
+ * NAIVE_BUDGET, by repeated multiplication, and measure performance. Times are wall clock times,
+ * since the kernel squaring runs through may use threads.
+ */
+void run(int n, int k, int modulus, matrix_power_workspace * workspace) {
+    int * A = (int *) malloc(n * n * sizeof(int));
+    int * C = (int *) malloc(n * n * sizeof(int));
+    int * D = (int *) malloc(n * n * sizeof(int));
+    initialize_matrix(n, A);
+    if (modulus != 0) {
+        for (int i = 0; i < n * n; i++) {
+            A[i] %= modulus;
+        }
+    }
+
+    double start = wall_time();
+    matrix_power(n, A, k, modulus, C, workspace);
+    double seconds = wall_time() - start;
+    if (n <= 8) {
+        printf("A^%i:\n", k);
+        print_matrix(n, C);
+    }
+    printf("Time elapsed after exponentiation by squaring with %s multiplication: %lf seconds\n\n",
+           modulus == 0 ? workspace->kernel->name : "modular", seconds);
+
+    // Repeated multiplication costs n^3 for each of the k products, so only compare against it
+    // when that fits the budget.
+    if ((double) n * n * n * k <= NAIVE_BUDGET) {
+        start = wall_time();
+        matrix_power_naive(n, A, k, modulus, D);
+        seconds = wall_time() - start;
+        printf("Time elapsed after repeated multiplication: %lf seconds\n\n", seconds);
+        verify(n, C, D);
+    } else {
+        printf("Skipped repeated multiplication, which would take %.0lf multiply-adds\n",
+               (double) n * n * n * k);
+    }
+
+    free(A);
+    free(C);
+    free(D);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3 || argc > 5) {
+        printf("Format: ./matrix_power base_2_exponent power [modulus [kernel]]\n");
+        print_kernels();
+        return 1;
+    }
+
+    // Ensure the maximum value of n is 1024 and the minimum value of n is 1.
+    int power = atoi(argv[1]);
+    if (power < 0 || power > 10) {
+        printf("Please input an exponent between 0 and 10");
+        return 1;
+    }
+
+    int k = atoi(argv[2]);
+    if (k < 0) {
+        printf("Please input a non-negative power\n");
+        return 1;
+    }
+
+    int modulus = argc > 3 ? atoi(argv[3]) : 0;
+    if (modulus < 0) {
+        printf("Please input a positive modulus, or 0 for none\n");
+        return 1;
+    }
+
+    int n = pow(2, power);
+    matrix_power_workspace * workspace = matrix_power_workspace_new(n, argc > 4 ? argv[4] : "auto");
+    if (workspace == NULL) {
+        return 1;
+    }
+
+    printf("n = %i, k = %i", n, k);
+    if (modulus != 0) {
+        printf(", modulus = %i", modulus);
+    }
+    printf("\n");
+    run(n, k, modulus, workspace);
+    matrix_power_workspace_free(workspace);
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * Allocator for matrix buffers. Small matrices are 64-byte aligned so rows start on a cache line.
+ * Matrices of 2MB or more are mapped directly and 2MB aligned, backed by huge pages when asked
+ * to, so a large matrix costs a handful of TLB entries instead of one per 4KB page. Pages can be
+ * faulted in and zeroed by several threads up front so that page faults stay out of timed code.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "matrix.h"
+
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define MAX_PREFAULT_THREADS 16
+
+/*
+ * Where an allocation came from, so that free_matrix can release it the same way.
+ */
+typedef struct allocation {
+    int * matrix;
+    void * mapping;
+    size_t mapping_bytes;
+    matrix_allocation_info info;
+    struct allocation * next;
+} allocation;
+
+typedef struct prefault_parameters {
+    char * start;
+    size_t bytes;
+} prefault_parameters;
+
+static allocation * allocations = NULL;
+static pthread_mutex_t allocations_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t round_up(size_t bytes, size_t multiple) {
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+/*
+ * Thread entry point for prefaulting: writing zeroes touches every page in the slice.
+ */
+static void * prefault_slice(void * prefault_parameters_arg) {
+    prefault_parameters * parameters = (prefault_parameters *) prefault_parameters_arg;
+    memset(parameters->start, 0, parameters->bytes);
+    return NULL;
+}
+
+/*
+ * Fault in and zero a buffer, splitting it into page-aligned slices across up to one thread per
+ * processor. The calling thread takes the last slice.
+ */
+static void prefault(char * buffer, size_t bytes, size_t page_size) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t pages = (bytes + page_size - 1) / page_size;
+    int workers = processors < 1 ? 1 : (int) processors;
+    if (workers > MAX_PREFAULT_THREADS) {
+        workers = MAX_PREFAULT_THREADS;
+    }
+    if ((size_t) workers > pages) {
+        workers = (int) pages;
+    }
+
+    pthread_t tids[MAX_PREFAULT_THREADS];
+    prefault_parameters slices[MAX_PREFAULT_THREADS];
+    for (int t_num = 0; t_num < workers; t_num++) {
+        size_t start = pages * t_num / workers * page_size;
+        size_t end = t_num == workers - 1 ? bytes : pages * (t_num + 1) / workers * page_size;
+        slices[t_num] = (prefault_parameters) {buffer + start, end - start};
+    }
+    for (int t_num = 0; t_num < workers - 1; t_num++) {
+        pthread_create(&tids[t_num], NULL, prefault_slice, &slices[t_num]);
+    }
+    prefault_slice(&slices[workers - 1]);
+    for (int t_num = 0; t_num < workers - 1; t_num++) {
+        pthread_join(tids[t_num], NULL);
+    }
+}
+
+/*
+ * Count how much of the mapping that contains address is backed by transparent huge pages,
+ * according to the AnonHugePages line of /proc/self/smaps. Returns 0 where that is unavailable.
+ */
+static size_t transparent_huge_bytes(void * address) {
+    FILE * fptr = fopen("/proc/self/smaps", "r");
+    if (fptr == NULL) {
+        return 0;
+    }
+
+    char line[256];
+    int in_mapping = 0;
+    size_t huge_bytes = 0;
+    while (fgets(line, sizeof(line), fptr)) {
+        unsigned long start;
+        unsigned long end;
+        unsigned long kilobytes;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            if (in_mapping) {
+                break;
+            }
+            in_mapping = (unsigned long) address >= start && (unsigned long) address < end;
+        } else if (in_mapping && sscanf(line, "AnonHugePages: %lu kB", &kilobytes) == 1) {
+            huge_bytes = kilobytes * 1024;
+        }
+    }
+    fclose(fptr);
+    return huge_bytes;
+}
+
+/*
+ * Map bytes of anonymous memory aligned to HUGE_PAGE_SIZE. With huge_pages set, first ask for
+ * explicit huge pages, which only succeeds if the administrator has reserved some, then fall
+ * back to ordinary pages with a transparent huge page hint. Stores the mapping to unmap later.
+ */
+static int * map_aligned(size_t bytes, int huge_pages, allocation * record) {
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        void * mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping != MAP_FAILED) {
+            record->mapping = mapping;
+            record->mapping_bytes = bytes;
+            record->info.huge_pages = MATRIX_HUGE_PAGES_EXPLICIT;
+            return (int *) mapping;
+        }
+    }
+#endif
+
+    // Over-allocate by one huge page and trim both ends so the buffer starts on a boundary.
+    size_t padded = bytes + HUGE_PAGE_SIZE;
+    char * mapping = (char *) mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+    char * aligned = (char *) round_up((size_t) mapping, HUGE_PAGE_SIZE);
+    if (aligned > mapping) {
+        munmap(mapping, aligned - mapping);
+    }
+    if (aligned + bytes < mapping + padded) {
+        munmap(aligned + bytes, mapping + padded - (aligned + bytes));
+    }
+    record->mapping = aligned;
+    record->mapping_bytes = bytes;
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && madvise(aligned, bytes, MADV_HUGEPAGE) == 0) {
+        record->info.huge_pages = MATRIX_HUGE_PAGES_TRANSPARENT;
+    }
+#endif
+    return (int *) aligned;
+}
+
+/*
+ * Allocate an n x n matrix. flags is any combination of MATRIX_ALLOCATE_HUGE_PAGES, to back
+ * matrices of 2MB or more with huge pages where the system allows, and MATRIX_ALLOCATE_PREFAULT,
+ * to fault in and zero every page in parallel before returning. Returns NULL if out of memory.
+ */
+int * allocate_matrix(int n, int flags) {
+    size_t bytes = (size_t) n * n * sizeof(int);
+    allocation * record = (allocation *) calloc(1, sizeof(allocation));
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    if (bytes < HUGE_PAGE_SIZE) {
+        record->info.alignment = CACHE_LINE_SIZE;
+        record->matrix = (int *) aligned_alloc(CACHE_LINE_SIZE, round_up(bytes, CACHE_LINE_SIZE));
+    } else {
+        bytes = round_up(bytes, HUGE_PAGE_SIZE);
+        record->info.alignment = HUGE_PAGE_SIZE;
+        record->matrix = map_aligned(bytes, flags & MATRIX_ALLOCATE_HUGE_PAGES, record);
+        if (record->info.huge_pages == MATRIX_HUGE_PAGES_EXPLICIT) {
+            page_size = HUGE_PAGE_SIZE;
+        }
+    }
+    if (record->matrix == NULL) {
+        free(record);
+        return NULL;
+    }
+    record->info.bytes = bytes;
+
+    if (flags & MATRIX_ALLOCATE_PREFAULT) {
+        prefault((char *) record->matrix, bytes, page_size);
+    }
+
+    pthread_mutex_lock(&allocations_lock);
+    record->next = allocations;
+    allocations = record;
+    pthread_mutex_unlock(&allocations_lock);
+    return record->matrix;
+}
+
+/*
+ * Release a matrix returned by allocate_matrix.
+ */
+void free_matrix(int * matrix) {
+    if (matrix == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&allocations_lock);
+    allocation ** link = &allocations;
+    while (*link && (*link)->matrix != matrix) {
+        link = &(*link)->next;
+    }
+    allocation * record = *link;
+    if (record) {
+        *link = record->next;
+    }
+    pthread_mutex_unlock(&allocations_lock);
+
+    if (record == NULL) {
+        fprintf(stderr, "free_matrix: %p was not returned by allocate_matrix\n", (void *) matrix);
+        return;
+    }
+    if (record->mapping) {
+        munmap(record->mapping, record->mapping_bytes);
+    } else {
+        free(record->matrix);
+    }
+    free(record);
+}
+
+/*
+ * Describe how a matrix was allocated, including how many of its bytes are currently backed by
+ * huge pages. Transparent huge pages are only assigned as pages are touched, so this is most
+ * meaningful after prefaulting. Returns 0 on success and -1 for an unknown matrix.
+ */
+int get_matrix_allocation_info(int * matrix, matrix_allocation_info * info) {
+    pthread_mutex_lock(&allocations_lock);
+    allocation * record = allocations;
+    while (record && record->matrix != matrix) {
+        record = record->next;
+    }
+    if (record) {
+        *info = record->info;
+    }
+    pthread_mutex_unlock(&allocations_lock);
+    if (record == NULL) {
+        return -1;
+    }
+
+    if (info->huge_pages == MATRIX_HUGE_PAGES_EXPLICIT) {
+        info->huge_bytes = info->bytes;
+    } else if (info->huge_pages == MATRIX_HUGE_PAGES_TRANSPARENT) {
+        info->huge_bytes = transparent_huge_bytes(matrix);
+    } else {
+        info->huge_bytes = 0;
+    }
+    return 0;
+}
+
+/*
+ * Print the alignment of a matrix and whether huge pages were actually obtained for it.
+ */
+void print_matrix_allocation(const char * name, int * matrix) {
+    matrix_allocation_info info;
+    if (get_matrix_allocation_info(matrix, &info) != 0) {
+        printf("%s: not allocated by allocate_matrix\n", name);
+        return;
+    }
+    const char * kind = "none";
+    if (info.huge_pages == MATRIX_HUGE_PAGES_EXPLICIT) {
+        kind = "explicit";
+    } else if (info.huge_pages == MATRIX_HUGE_PAGES_TRANSPARENT) {
+        kind = "transparent";
+    }
+    printf("%s: %zu bytes, %zu-byte aligned, huge pages: %s, %zu of %zu bytes on huge pages\n",
+           name, info.bytes, info.alignment, kind, info.huge_bytes, info.bytes);
+}
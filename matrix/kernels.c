@@ -0,0 +1,448 @@
+/*
+ * Square matrix multiplication kernels and the registry that lets programs select them by name.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ * Dylan Leddy - dylan.leddy@bc.edu
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "matrix.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#define BLOCK_SIZE 32
+#define WORKER_COUNT 4
+
+typedef struct multiply_parameters {
+    int n;
+    int * A;
+    int * B;
+    int * C;
+    int row_start;
+    int row_end;
+} multiply_parameters;
+
+/*
+ * Multiply rows row_start up to row_end of A by B into the same rows of C, adding one entry at a
+ * time.
+ */
+static void multiply_rows(int n, int * A, int * B, int * C, int row_start, int row_end) {
+    for (int i = row_start; i < row_end; i++) {
+        for (int j = 0; j < n; j++) {
+            int c_entry = 0;
+            for (int k = 0; k < n; k++) {
+                c_entry += A[i * n + k] * B[k * n + j];
+            }
+            C[i * n + j] = c_entry;
+        }
+    }
+}
+
+/*
+ * Multiply two matrices A and B without transposition.
+ */
+void multiply_standard(int n, int * A, int * B, int * C) {
+    multiply_rows(n, A, B, C, 0, n);
+}
+
+/*
+ * Multiply two matrices A and B, first transposing a copy of B to get better spacial locality.
+ */
+void multiply_transpose(int n, int * A, int * B, int * C) {
+    int * B_transposed = (int *) malloc(n * n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            B_transposed[j * n + i] = B[i * n + j];
+        }
+    }
+    for (int i = 0; i < n; i++){
+        for (int j = 0; j < n; j++) {
+            int c_entry = 0;
+            for (int k = 0; k < n; k++) {
+                c_entry += A[i * n + k] * B_transposed[j * n + k];
+            }
+            C[i * n + j] = c_entry;
+        }
+    }
+    free(B_transposed);
+}
+
+/*
+ * Multiply two matrices A and B one tile x tile block at a time, so that the blocks of A, B, and C
+ * being worked on stay in cache. Within a block, rows of B are streamed in i-k-j order.
+ */
+void multiply_blocked_tiled(int n, int * A, int * B, int * C, int tile) {
+    for (int i = 0; i < n * n; i++) {
+        C[i] = 0;
+    }
+    for (int ii = 0; ii < n; ii += tile) {
+        int i_end = ii + tile < n ? ii + tile : n;
+        for (int kk = 0; kk < n; kk += tile) {
+            int k_end = kk + tile < n ? kk + tile : n;
+            for (int jj = 0; jj < n; jj += tile) {
+                int j_end = jj + tile < n ? jj + tile : n;
+                for (int i = ii; i < i_end; i++) {
+                    for (int k = kk; k < k_end; k++) {
+                        int a = A[i * n + k];
+                        for (int j = jj; j < j_end; j++) {
+                            C[i * n + j] += a * B[k * n + j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Multiply two matrices A and B in BLOCK_SIZE x BLOCK_SIZE blocks.
+ */
+void multiply_blocked(int n, int * A, int * B, int * C) {
+    multiply_blocked_tiled(n, A, B, C, BLOCK_SIZE);
+}
+
+/*
+ * Multiply in i-k-j order so that the innermost loop scales a row of B and adds it to a row of C,
+ * which the compiler can vectorize on any target.
+ */
+static void multiply_row_updates(int n, int * A, int * B, int * C) {
+    for (int i = 0; i < n; i++) {
+        int * C_row = C + i * n;
+        for (int j = 0; j < n; j++) {
+            C_row[j] = 0;
+        }
+        for (int k = 0; k < n; k++) {
+            int a = A[i * n + k];
+            int * B_row = B + k * n;
+            for (int j = 0; j < n; j++) {
+                C_row[j] += a * B_row[j];
+            }
+        }
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * The i-k-j kernel with explicit AVX2: eight entries of a row of C are updated per instruction.
+ */
+__attribute__((target("avx2")))
+static void multiply_row_updates_avx2(int n, int * A, int * B, int * C) {
+    for (int i = 0; i < n; i++) {
+        int * C_row = C + i * n;
+        for (int j = 0; j < n; j++) {
+            C_row[j] = 0;
+        }
+        for (int k = 0; k < n; k++) {
+            __m256i a = _mm256_set1_epi32(A[i * n + k]);
+            int * B_row = B + k * n;
+            int j = 0;
+            for (; j + 8 <= n; j += 8) {
+                __m256i b = _mm256_loadu_si256((__m256i *) (B_row + j));
+                __m256i c = _mm256_loadu_si256((__m256i *) (C_row + j));
+                c = _mm256_add_epi32(c, _mm256_mullo_epi32(a, b));
+                _mm256_storeu_si256((__m256i *) (C_row + j), c);
+            }
+            // Finish rows narrower than a vector one entry at a time.
+            for (; j < n; j++) {
+                C_row[j] += A[i * n + k] * B_row[j];
+            }
+        }
+    }
+}
+#endif
+
+/*
+ * Multiply two matrices A and B with SIMD instructions, using AVX2 when the processor has it.
+ */
+void multiply_simd(int n, int * A, int * B, int * C) {
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        multiply_row_updates_avx2(n, A, B, C);
+        return;
+    }
+#endif
+    multiply_row_updates(n, A, B, C);
+}
+
+/*
+ * Define multiply_fixed_N, the i-k-j kernel for one constant n. With the size known at compile
+ * time every stride is a constant and the compiler vectorizes the loop over a row of C and
+ * unrolls it completely, leaving no bounds checks or remainder loop.
+ */
+#define DEFINE_FIXED_KERNEL(N) \
+    static void multiply_fixed_##N(int * A, int * B, int * C) { \
+        for (int i = 0; i < N; i++) { \
+            int C_row[N] = {0}; \
+            for (int k = 0; k < N; k++) { \
+                int a = A[i * N + k]; \
+                for (int j = 0; j < N; j++) { \
+                    C_row[j] += a * B[k * N + j]; \
+                } \
+            } \
+            for (int j = 0; j < N; j++) { \
+                C[i * N + j] = C_row[j]; \
+            } \
+        } \
+    }
+
+#define FIXED_KERNEL_SIZES(X) X(2) X(4) X(8) X(16) X(32) X(64)
+#define MAX_FIXED_N 64
+
+typedef void (*fixed_function)(int * A, int * B, int * C);
+
+#define FIXED_TABLE_ENTRY(N) [N] = multiply_fixed_##N,
+
+FIXED_KERNEL_SIZES(DEFINE_FIXED_KERNEL)
+static const fixed_function fixed_kernels[MAX_FIXED_N + 1] = {
+    FIXED_KERNEL_SIZES(FIXED_TABLE_ENTRY)
+};
+
+#ifdef HAVE_X86_SIMD
+/*
+ * Define multiply_fixed_N_avx2 for a constant n that is a multiple of 8. A whole row of C is held
+ * in n / 8 vector registers while it is accumulated, so C is stored once per row instead of being
+ * loaded and stored for every k.
+ */
+#define DEFINE_FIXED_KERNEL_AVX2(N) \
+    __attribute__((target("avx2"))) \
+    static void multiply_fixed_##N##_avx2(int * A, int * B, int * C) { \
+        for (int i = 0; i < N; i++) { \
+            __m256i C_row[N / 8]; \
+            _Pragma("GCC unroll 8") \
+            for (int v = 0; v < N / 8; v++) { \
+                C_row[v] = _mm256_setzero_si256(); \
+            } \
+            for (int k = 0; k < N; k++) { \
+                __m256i a = _mm256_set1_epi32(A[i * N + k]); \
+                _Pragma("GCC unroll 8") \
+                for (int v = 0; v < N / 8; v++) { \
+                    __m256i b = _mm256_loadu_si256((__m256i *) (B + k * N + 8 * v)); \
+                    C_row[v] = _mm256_add_epi32(C_row[v], _mm256_mullo_epi32(a, b)); \
+                } \
+            } \
+            _Pragma("GCC unroll 8") \
+            for (int v = 0; v < N / 8; v++) { \
+                _mm256_storeu_si256((__m256i *) (C + i * N + 8 * v), C_row[v]); \
+            } \
+        } \
+    }
+
+#define FIXED_KERNEL_SIZES_AVX2(X) X(8) X(16) X(32) X(64)
+
+#define FIXED_TABLE_ENTRY_AVX2(N) [N] = multiply_fixed_##N##_avx2,
+
+FIXED_KERNEL_SIZES_AVX2(DEFINE_FIXED_KERNEL_AVX2)
+// Sizes narrower than a vector keep the portable kernels, which are already fully unrolled.
+static const fixed_function fixed_kernels_avx2[MAX_FIXED_N + 1] = {
+    [2] = multiply_fixed_2,
+    [4] = multiply_fixed_4,
+    FIXED_KERNEL_SIZES_AVX2(FIXED_TABLE_ENTRY_AVX2)
+};
+#endif
+
+/*
+ * Multiply two matrices A and B with a kernel specialized for n when one was generated, which is
+ * every power of two from 2 to 64, and with multiply_simd otherwise.
+ */
+void multiply_fixed(int n, int * A, int * B, int * C) {
+    const fixed_function * table = fixed_kernels;
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        table = fixed_kernels_avx2;
+    }
+#endif
+    if (n <= MAX_FIXED_N && table[n] != NULL) {
+        table[n](A, B, C);
+        return;
+    }
+    multiply_simd(n, A, B, C);
+}
+
+/*
+ * Thread entry point for multiply_threaded. Takes a structure, multiply_parameters_arg,
+ * containing the matrices and the rows this thread is responsible for.
+ */
+static void * multiply_thread(void * multiply_parameters_arg) {
+    multiply_parameters * parameters = (multiply_parameters *) multiply_parameters_arg;
+    multiply_rows(parameters->n, parameters->A, parameters->B, parameters->C,
+                  parameters->row_start, parameters->row_end);
+    return NULL;
+}
+
+/*
+ * Multiply two matrices A and B with POSIX threads. workers - 1 additional threads each compute a
+ * band of rows while the calling thread computes the last band.
+ */
+void multiply_threaded_workers(int n, int * A, int * B, int * C, int workers) {
+    pthread_t * tids = (pthread_t *) malloc(workers * sizeof(pthread_t));
+    multiply_parameters * thread_parameters =
+        (multiply_parameters *) malloc(workers * sizeof(multiply_parameters));
+
+    for (int t_num = 0; t_num < workers; t_num++) {
+        thread_parameters[t_num] = (multiply_parameters) {
+            n, A, B, C, t_num * n / workers, (t_num + 1) * n / workers
+        };
+    }
+    for (int t_num = 0; t_num < workers - 1; t_num++) {
+        pthread_create(&tids[t_num], NULL, multiply_thread, &thread_parameters[t_num]);
+    }
+
+    // Have the calling thread calculate a subset of the rows of the product matrix as well.
+    multiply_thread(&thread_parameters[workers - 1]);
+
+    // Wait until all threads have finished before looking at the output matrix.
+    for (int t_num = 0; t_num < workers - 1; t_num++) {
+        pthread_join(tids[t_num], NULL);
+    }
+    free(tids);
+    free(thread_parameters);
+}
+
+/*
+ * Multiply two matrices A and B with WORKER_COUNT threads, counting the calling thread.
+ */
+void multiply_threaded(int n, int * A, int * B, int * C) {
+    multiply_threaded_workers(n, A, B, C, WORKER_COUNT);
+}
+
+/*
+ * Multiply a band of rows and write the entries of the product into a binary file.
+ */
+static void multiply_rows_to_file(int n, int * A, int * B, char * file_name, int row_start,
+                                  int row_end) {
+    FILE * fptr = fopen(file_name, "wb");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return;
+    }
+    for (int i = row_start; i < row_end; i++) {
+        for (int j = 0; j < n; j++) {
+            int c_entry = 0;
+            for (int k = 0; k < n; k++) {
+                c_entry += A[i * n + k] * B[k * n + j];
+            }
+            fwrite(&c_entry, sizeof(int), 1, fptr);
+        }
+    }
+    fclose(fptr);
+}
+
+/*
+ * Multiply two matrices A and B with processes. workers - 1 child processes each write a band of
+ * rows to c_parallel<p_num>.bin while the parent writes the last band, and the parent reassembles
+ * the bands into C once every child has exited.
+ */
+void multiply_forked_workers(int n, int * A, int * B, int * C, int workers) {
+    char file_name[32];
+    pid_t * child_pids = (pid_t *) malloc(workers * sizeof(pid_t));
+    int p_num;
+
+    // Flush pending output so that it is not duplicated into the children.
+    fflush(stdout);
+    for (p_num = 0; p_num < workers - 1; p_num++) {
+        pid_t pid = fork();
+        // The child calculates its rows and exits; only the parent should be forking.
+        if (pid == 0) {
+            sprintf(file_name, "c_parallel%i.bin", p_num);
+            multiply_rows_to_file(n, A, B, file_name, p_num * n / workers,
+                                  (p_num + 1) * n / workers);
+            _exit(0);
+        }
+        child_pids[p_num] = pid;
+    }
+
+    // Have the parent process calculate a subset of the rows of the product matrix as well.
+    sprintf(file_name, "c_parallel%i.bin", p_num);
+    multiply_rows_to_file(n, A, B, file_name, p_num * n / workers, n);
+
+    for (p_num = 0; p_num < workers - 1; p_num++) {
+        int status;
+        waitpid(child_pids[p_num], &status, 0);
+    }
+    free(child_pids);
+
+    // Reassemble the bands, using p_num to compute where in C each one belongs.
+    for (p_num = 0; p_num < workers; p_num++) {
+        int row_start = p_num * n / workers;
+        int row_end = (p_num + 1) * n / workers;
+        sprintf(file_name, "c_parallel%i.bin", p_num);
+        FILE * fptr = fopen(file_name, "rb");
+        if (fptr == NULL) {
+            printf("File could not be opened\n");
+            continue;
+        }
+        if (fread(C + row_start * n, sizeof(int), (row_end - row_start) * n, fptr)
+            != (size_t) ((row_end - row_start) * n)) {
+            printf("File could not be read\n");
+        }
+        fclose(fptr);
+    }
+}
+
+/*
+ * Multiply two matrices A and B with WORKER_COUNT processes, counting the parent.
+ */
+void multiply_forked(int n, int * A, int * B, int * C) {
+    multiply_forked_workers(n, A, B, C, WORKER_COUNT);
+}
+
+// The profile multiply_auto follows, read by the first call through pthread_once so that
+// threads calling multiply_auto at once do not fill it in together.
+static tuning_profile auto_profile;
+static pthread_once_t auto_profile_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Read the profile for multiply_auto from the file named by the MATRIX_TUNING_PROFILE environment
+ * variable or DEFAULT_TUNING_PROFILE, leaving it empty if the file can not be used.
+ */
+static void load_auto_profile(void) {
+    char * path = getenv("MATRIX_TUNING_PROFILE");
+    if (load_tuning_profile(path ? path : DEFAULT_TUNING_PROFILE, &auto_profile) != 0) {
+        auto_profile.count = 0;
+    }
+}
+
+/*
+ * Multiply two matrices A and B with whichever kernel and parameter the tuning profile found
+ * fastest for the closest tuned size. The profile is read once, by the first call. Without a
+ * profile, fall back to the serial SIMD kernel, which never pays for starting threads or
+ * processes.
+ */
+void multiply_auto(int n, int * A, int * B, int * C) {
+    pthread_once(&auto_profile_once, load_auto_profile);
+
+    const tuning_choice * choice = choose_tuning(&auto_profile, n);
+    if (choice == NULL) {
+        multiply_simd(n, A, B, C);
+    } else if (choice->kernel->multiply_with) {
+        choice->kernel->multiply_with(n, A, B, C, choice->parameter);
+    } else {
+        choice->kernel->multiply(n, A, B, C);
+    }
+}
+
+const matrix_kernel matrix_kernels[] = {
+    {"standard", "triple loop in i-j-k order", multiply_standard, NULL, NULL},
+    {"transpose", "transpose a copy of B, then take row-by-row dot products", multiply_transpose,
+     NULL, NULL},
+    {"blocked", "i-k-j order over cache-sized tiles", multiply_blocked, multiply_blocked_tiled,
+     "tile"},
+    {"simd", "i-k-j order with AVX2 when available", multiply_simd, NULL, NULL},
+    {"fixed", "simd with loops fully unrolled for n from 2 to 64", multiply_fixed, NULL, NULL},
+    {"threaded", "rows split across POSIX threads", multiply_threaded, multiply_threaded_workers,
+     "threads"},
+    {"forked", "rows split across child processes through binary files", multiply_forked,
+     multiply_forked_workers, "processes"},
+    {"auto", "fastest kernel for n according to the tuning profile", multiply_auto, NULL, NULL},
+    {"cached", "auto behind a content-addressed cache of earlier products", multiply_cached, NULL,
+     NULL},
+};
+
+const int matrix_kernel_count = sizeof(matrix_kernels) / sizeof(matrix_kernel);
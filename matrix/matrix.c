@@ -0,0 +1,279 @@
+/*
+ * Helpers shared by every matrix program: initializing, printing, and comparing matrices, and
+ * selecting, benchmarking, and verifying kernels from the registry by name, and reading and
+ * writing the tuning profiles that multiply_auto consults.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "matrix.h"
+
+/*
+ * Initialize a matrix with pseudo-random numbers from 0-9.
+ */
+void initialize_matrix(int n, int * matrix) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            matrix[i * n + j] = rand() % 10;
+        }
+    }
+}
+
+/*
+ * Print the entries of a matrix in a visually organized manner.
+ */
+void print_matrix(int n, int * matrix) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            printf("%i ", matrix[i * n + j]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+/*
+ * Transpose in place by iterating over only the top right diagonal half of the matrix and
+ * swapping elements.
+ */
+void transpose(int n, int * matrix) {
+    int temp;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            temp = matrix[i * n + j];
+            matrix[i * n + j] = matrix[j * n + i];
+            matrix[j * n + i] = temp;
+        }
+    }
+}
+
+/*
+ * Check the corresponding entries of two matrices. Returns 1 if they all match and 0 otherwise.
+ */
+int matrices_equal(int n, int * C, int * D) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            if (C[i * n + j] != D[i * n + j]) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * Check the corresponding entries of two matrices and report whether they have the same values.
+ */
+void verify(int n, int * C, int * D) {
+    if (matrices_equal(n, C, D)) {
+        printf("RESULTS ARE THE SAME\n");
+    } else {
+        printf("RESULTS ARE NOT THE SAME\n");
+    }
+}
+
+/*
+ * Read a monotonic wall clock in seconds. clock() adds up the CPU time of every thread, which
+ * hides any speedup from the threaded kernels, so kernels are timed with this instead.
+ */
+double wall_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Look up a kernel in the registry by name. Returns NULL if there is no such kernel.
+ */
+const matrix_kernel * find_kernel(const char * name) {
+    for (int i = 0; i < matrix_kernel_count; i++) {
+        if (strcmp(matrix_kernels[i].name, name) == 0) {
+            return &matrix_kernels[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * List the registered kernels and what they do.
+ */
+void print_kernels(void) {
+    printf("Kernels:\n");
+    for (int i = 0; i < matrix_kernel_count; i++) {
+        printf("\t%-10s -- %s\n", matrix_kernels[i].name, matrix_kernels[i].description);
+    }
+    printf("\tall        -- every kernel above\n");
+}
+
+/*
+ * Resolve kernel names from the command line, falling back to default_names when count is 0 or
+ * less. The name "all" selects every kernel. Returns a heap array of the selected kernels and
+ * stores its length in selected_count, or returns NULL after listing the known kernels if a name
+ * is not registered.
+ */
+const matrix_kernel ** select_kernels(int count, char ** names, char ** default_names,
+                                      int default_count, int * selected_count) {
+    if (count <= 0) {
+        count = default_count;
+        names = default_names;
+    }
+    const matrix_kernel ** selected =
+        (const matrix_kernel **) malloc(count * matrix_kernel_count * sizeof(matrix_kernel *));
+    *selected_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], "all") == 0) {
+            for (int k = 0; k < matrix_kernel_count; k++) {
+                selected[(*selected_count)++] = &matrix_kernels[k];
+            }
+            continue;
+        }
+        const matrix_kernel * kernel = find_kernel(names[i]);
+        if (kernel == NULL) {
+            printf("Unknown kernel: %s\n", names[i]);
+            print_kernels();
+            free(selected);
+            return NULL;
+        }
+        selected[(*selected_count)++] = kernel;
+    }
+    return selected;
+}
+
+/*
+ * Randomly generate n x n matrices A and B, multiply them with each of the given kernels, and
+ * measure performance. Every product is verified against the product of the first kernel.
+ */
+void benchmark_kernels(int n, const matrix_kernel ** kernels, int count, int print_products) {
+    // Fault every page in before timing anything, so that no kernel pays for first touches.
+    int flags = MATRIX_ALLOCATE_HUGE_PAGES | MATRIX_ALLOCATE_PREFAULT;
+    int * A = allocate_matrix(n, flags);
+    int * B = allocate_matrix(n, flags);
+    int * reference = allocate_matrix(n, flags);
+    int * C = allocate_matrix(n, flags);
+    initialize_matrix(n, A);
+    initialize_matrix(n, B);
+    if (n >= 1024) {
+        print_matrix_allocation("A", A);
+        printf("\n");
+    }
+
+    if (print_products) {
+        printf("A:\n");
+        print_matrix(n, A);
+        printf("B:\n");
+        print_matrix(n, B);
+    }
+
+    for (int i = 0; i < count; i++) {
+        int * product = i == 0 ? reference : C;
+
+        double start = wall_time();
+        kernels[i]->multiply(n, A, B, product);
+        double end = wall_time();
+
+        if (print_products) {
+            printf("A x B using %s multiplication:\n", kernels[i]->name);
+            print_matrix(n, product);
+        }
+        printf("Time elapsed after %s multiplication: %lf seconds\n", kernels[i]->name,
+               end - start);
+
+        if (i > 0) {
+            printf("%s vs %s: ", kernels[i]->name, kernels[0]->name);
+            verify(n, reference, product);
+        }
+        printf("\n");
+    }
+
+    free_matrix(A);
+    free_matrix(B);
+    free_matrix(reference);
+    free_matrix(C);
+}
+
+/*
+ * Read a tuning profile written by save_tuning_profile. Lines starting with '#' are comments and
+ * every other line is "n kernel parameter seconds". Returns 0 on success and -1 if the file can
+ * not be opened or has an entry the auto kernel could not run: a kernel that is not registered,
+ * the auto or cached kernel, which would call back into multiply_auto forever, a parameter below
+ * 1 for a kernel that takes one, or a size below 1.
+ */
+int load_tuning_profile(const char * path, tuning_profile * profile) {
+    FILE * fptr = fopen(path, "r");
+    if (fptr == NULL) {
+        return -1;
+    }
+
+    char line[256];
+    char name[64];
+    profile->count = 0;
+    while (fgets(line, sizeof(line), fptr) && profile->count < MAX_TUNING_CHOICES) {
+        tuning_choice * choice = &profile->choices[profile->count];
+        if (line[0] == '#' || sscanf(line, "%i %63s %i %lf", &choice->n, name, &choice->parameter,
+                                     &choice->seconds) != 4) {
+            continue;
+        }
+        choice->kernel = find_kernel(name);
+        if (choice->kernel == NULL) {
+            printf("Unknown kernel in tuning profile %s: %s\n", path, name);
+            fclose(fptr);
+            return -1;
+        }
+        if (choice->kernel->multiply == multiply_auto ||
+            choice->kernel->multiply == multiply_cached) {
+            printf("Kernel in tuning profile %s can not be %s\n", path, name);
+            fclose(fptr);
+            return -1;
+        }
+        if (choice->n < 1 || (choice->kernel->multiply_with && choice->parameter < 1)) {
+            printf("Invalid entry in tuning profile %s: %s", path, line);
+            fclose(fptr);
+            return -1;
+        }
+        profile->count++;
+    }
+    fclose(fptr);
+    return 0;
+}
+
+/*
+ * Write a tuning profile as text, one size per line. Returns 0 on success and -1 if the file can
+ * not be opened.
+ */
+int save_tuning_profile(const char * path, tuning_profile * profile) {
+    FILE * fptr = fopen(path, "w");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return -1;
+    }
+    fprintf(fptr, "# n kernel parameter seconds\n");
+    for (int i = 0; i < profile->count; i++) {
+        tuning_choice * choice = &profile->choices[i];
+        fprintf(fptr, "%i %s %i %.9lf\n", choice->n, choice->kernel->name, choice->parameter,
+                choice->seconds);
+    }
+    fclose(fptr);
+    return 0;
+}
+
+/*
+ * Find the profile entry for the tuned size closest to n, measured by ratio rather than
+ * difference since the cost of every kernel grows as a power of n. Returns NULL for an empty
+ * profile.
+ */
+const tuning_choice * choose_tuning(const tuning_profile * profile, int n) {
+    const tuning_choice * best = NULL;
+    double best_distance = 0;
+    for (int i = 0; i < profile->count; i++) {
+        const tuning_choice * choice = &profile->choices[i];
+        double ratio = choice->n > n ? (double) choice->n / n : (double) n / choice->n;
+        if (best == NULL || ratio < best_distance) {
+            best = choice;
+            best_distance = ratio;
+        }
+    }
+    return best;
+}
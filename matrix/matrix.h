@@ -0,0 +1,101 @@
+/*
+ * Shared square matrix helpers and the registry of multiplication kernels used by the programs in
+ * cachelocality/, threads/, and parallelism/.
+ * Compile a driver with:
+ *     gcc driver.c ../matrix/matrix.c ../matrix/kernels.c ../matrix/allocator.c
+ *     ../matrix/product_cache.c -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+
+// Any kernel that writes A x B into C for n x n matrices. Kernels never modify A or B.
+typedef void (*multiply_function)(int n, int * A, int * B, int * C);
+
+// A kernel whose speed depends on one tuning parameter, such as a tile size or worker count.
+typedef void (*tunable_function)(int n, int * A, int * B, int * C, int parameter);
+
+// multiply_with and parameter_name are NULL for kernels without a tuning parameter.
+typedef struct matrix_kernel {
+    const char * name;
+    const char * description;
+    multiply_function multiply;
+    tunable_function multiply_with;
+    const char * parameter_name;
+} matrix_kernel;
+
+// Every kernel, in the order they are listed and benchmarked.
+extern const matrix_kernel matrix_kernels[];
+extern const int matrix_kernel_count;
+
+#define DEFAULT_TUNING_PROFILE "matrix_tuning.profile"
+#define MAX_TUNING_CHOICES 32
+
+// The fastest kernel and parameter measured for one size.
+typedef struct tuning_choice {
+    int n;
+    const matrix_kernel * kernel;
+    int parameter;
+    double seconds;
+} tuning_choice;
+
+typedef struct tuning_profile {
+    int count;
+    tuning_choice choices[MAX_TUNING_CHOICES];
+} tuning_profile;
+
+// Flags for allocate_matrix.
+#define MATRIX_ALLOCATE_HUGE_PAGES 1
+#define MATRIX_ALLOCATE_PREFAULT 2
+
+// Values of matrix_allocation_info.huge_pages.
+#define MATRIX_HUGE_PAGES_NONE 0
+#define MATRIX_HUGE_PAGES_EXPLICIT 1
+#define MATRIX_HUGE_PAGES_TRANSPARENT 2
+
+typedef struct matrix_allocation_info {
+    size_t bytes;
+    size_t alignment;
+    int huge_pages;
+    size_t huge_bytes;
+} matrix_allocation_info;
+
+int * allocate_matrix(int n, int flags);
+void free_matrix(int * matrix);
+int get_matrix_allocation_info(int * matrix, matrix_allocation_info * info);
+void print_matrix_allocation(const char * name, int * matrix);
+
+void initialize_matrix(int n, int * matrix);
+void print_matrix(int n, int * matrix);
+void transpose(int n, int * matrix);
+int matrices_equal(int n, int * C, int * D);
+void verify(int n, int * C, int * D);
+double wall_time(void);
+
+const matrix_kernel * find_kernel(const char * name);
+void print_kernels(void);
+const matrix_kernel ** select_kernels(int count, char ** names, char ** default_names,
+                                      int default_count, int * selected_count);
+void benchmark_kernels(int n, const matrix_kernel ** kernels, int count, int print_products);
+
+int load_tuning_profile(const char * path, tuning_profile * profile);
+int save_tuning_profile(const char * path, tuning_profile * profile);
+const tuning_choice * choose_tuning(const tuning_profile * profile, int n);
+
+void multiply_standard(int n, int * A, int * B, int * C);
+void multiply_transpose(int n, int * A, int * B, int * C);
+void multiply_blocked(int n, int * A, int * B, int * C);
+void multiply_blocked_tiled(int n, int * A, int * B, int * C, int tile);
+void multiply_simd(int n, int * A, int * B, int * C);
+void multiply_fixed(int n, int * A, int * B, int * C);
+void multiply_threaded(int n, int * A, int * B, int * C);
+void multiply_threaded_workers(int n, int * A, int * B, int * C, int workers);
+void multiply_forked(int n, int * A, int * B, int * C);
+void multiply_forked_workers(int n, int * A, int * B, int * C, int workers);
+void multiply_auto(int n, int * A, int * B, int * C);
+void multiply_cached(int n, int * A, int * B, int * C);
+
+#endif
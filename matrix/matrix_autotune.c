@@ -0,0 +1,176 @@
+/*
+ * Program to tune matrix multiplication for this machine. Run it once after building: it times
+ * every registered kernel, tile size, thread count, and process count over a sweep of n and
+ * writes the fastest choice for each n to a tuning profile, which the "auto" kernel reads.
+ * Compile with: gcc matrix_autotune.c matrix.c kernels.c allocator.c product_cache.c -lm -lpthread
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "matrix.h"
+
+#define MAX_CANDIDATES 64
+#define MAX_REPETITIONS 5
+#define MIN_MEASURED_SECONDS 0.02
+#define PRUNE_FACTOR 10
+
+/*
+ * One kernel and parameter to try at every size, with its time at the previous size.
+ */
+typedef struct candidate {
+    const matrix_kernel * kernel;
+    int parameter;
+    double last_seconds;
+} candidate;
+
+/*
+ * List every kernel once, except that tunable kernels are listed once per parameter value: tile
+ * sizes from 8 to 128 and worker counts from 2 to twice the number of processors.
+ */
+int list_candidates(candidate * candidates) {
+    int count = 0;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors < 1) {
+        processors = 1;
+    }
+
+    for (int k = 0; k < matrix_kernel_count; k++) {
+        const matrix_kernel * kernel = &matrix_kernels[k];
+        // The auto kernel is what is being tuned, so it is not a candidate itself, and neither is
+        // the cached kernel, which runs it and would time only cache hits after the first run.
+        if (kernel->multiply == multiply_auto || kernel->multiply == multiply_cached) {
+            continue;
+        }
+        if (kernel->multiply_with == NULL) {
+            candidates[count++] = (candidate) {kernel, 0, 0};
+        } else if (kernel->multiply_with == multiply_blocked_tiled) {
+            for (int tile = 8; tile <= 128; tile *= 2) {
+                candidates[count++] = (candidate) {kernel, tile, 0};
+            }
+        } else {
+            for (int workers = 2; workers <= 2 * processors && count < MAX_CANDIDATES;
+                 workers *= 2) {
+                candidates[count++] = (candidate) {kernel, workers, 0};
+            }
+        }
+    }
+    return count;
+}
+
+/*
+ * Time one candidate on A x B, repeating short runs and keeping the fastest so that small sizes
+ * are not dominated by timer resolution.
+ */
+double time_candidate(candidate * c, int n, int * A, int * B, int * C) {
+    double best = -1;
+    double total = 0;
+    for (int repetition = 0; repetition < MAX_REPETITIONS && total < MIN_MEASURED_SECONDS;
+         repetition++) {
+        double start = wall_time();
+        if (c->kernel->multiply_with) {
+            c->kernel->multiply_with(n, A, B, C, c->parameter);
+        } else {
+            c->kernel->multiply(n, A, B, C);
+        }
+        double elapsed = wall_time() - start;
+        total += elapsed;
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+/*
+ * Tune every size from 2^0 to 2^max_exponent and fill the profile with the winners. Candidates
+ * that were more than PRUNE_FACTOR times slower than the winner at the previous size are not
+ * timed again, which keeps the slow kernels from dominating the sweep at large n.
+ */
+void autotune(int max_exponent, tuning_profile * profile) {
+    candidate candidates[MAX_CANDIDATES];
+    int candidate_count = list_candidates(candidates);
+    double last_best = 0;
+    profile->count = 0;
+
+    for (int e = 0; e <= max_exponent && profile->count < MAX_TUNING_CHOICES; e++) {
+        int n = pow(2, e);
+        int flags = MATRIX_ALLOCATE_HUGE_PAGES | MATRIX_ALLOCATE_PREFAULT;
+        int * A = allocate_matrix(n, flags);
+        int * B = allocate_matrix(n, flags);
+        int * reference = allocate_matrix(n, flags);
+        int * C = allocate_matrix(n, flags);
+        initialize_matrix(n, A);
+        initialize_matrix(n, B);
+        multiply_standard(n, A, B, reference);
+
+        tuning_choice * choice = &profile->choices[profile->count++];
+        choice->n = n;
+        choice->kernel = NULL;
+        for (int i = 0; i < candidate_count; i++) {
+            candidate * c = &candidates[i];
+            if (last_best > 0 && c->last_seconds > PRUNE_FACTOR * last_best) {
+                continue;
+            }
+            c->last_seconds = time_candidate(c, n, A, B, C);
+            if (!matrices_equal(n, reference, C)) {
+                printf("%s gave a wrong product at n = %i and was skipped\n", c->kernel->name, n);
+                continue;
+            }
+            if (choice->kernel == NULL || c->last_seconds < choice->seconds) {
+                choice->kernel = c->kernel;
+                choice->parameter = c->parameter;
+                choice->seconds = c->last_seconds;
+            }
+        }
+        if (choice->kernel == NULL) {
+            // Every candidate was pruned or wrong, so there is nothing to record for this size.
+            printf("n = %4i: no kernel gave a correct product\n", n);
+            profile->count--;
+            free_matrix(A);
+            free_matrix(B);
+            free_matrix(reference);
+            free_matrix(C);
+            continue;
+        }
+        last_best = choice->seconds;
+
+        printf("n = %4i: %-10s", n, choice->kernel->name);
+        if (choice->kernel->parameter_name) {
+            printf(" %-9s = %3i", choice->kernel->parameter_name, choice->parameter);
+        } else {
+            printf(" %15s", "");
+        }
+        printf(" %lf seconds\n", choice->seconds);
+
+        free_matrix(A);
+        free_matrix(B);
+        free_matrix(reference);
+        free_matrix(C);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 3) {
+        printf("Format: ./matrix_autotune [max_base_2_exponent [profile]]\n");
+        return 1;
+    }
+
+    int max_exponent = argc > 1 ? atoi(argv[1]) : 9;
+    if (max_exponent < 0 || max_exponent > 10) {
+        printf("Please input an exponent between 0 and 10");
+        return 1;
+    }
+    char * path = argc > 2 ? argv[2] : DEFAULT_TUNING_PROFILE;
+
+    tuning_profile profile;
+    autotune(max_exponent, &profile);
+    if (save_tuning_profile(path, &profile) != 0) {
+        return 1;
+    }
+    printf("\nWrote tuning profile to %s\n", path);
+
+    return 0;
+}
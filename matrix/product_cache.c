@@ -0,0 +1,435 @@
+/*
+ * Cache layer in front of the matrix multiply kernels. A product is looked up by a 64-bit hash of
+ * n, A, and B, so a repeated product costs one pass over its inputs instead of n^3 work. Recently
+ * used products are kept in memory up to a byte budget; the least recently used are evicted and,
+ * if a spill directory is given, written there as .product files to be read back later.
+ * The "cached" kernel in the registry puts one process-wide cache in front of multiply_auto.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "product_cache.h"
+
+#define BUCKET_COUNT 1024
+#define MAX_PATH_SIZE 512
+// Entries of each factor stored with a product and compared on every hit.
+#define PREFIX_WORDS 4
+// Memory budget of the cache behind the "cached" kernel unless MATRIX_CACHE_BYTES says otherwise.
+#define DEFAULT_CACHE_BYTES (256L << 20)
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+/*
+ * What a product is matched on besides its hash: the size and the first entries of each factor,
+ * with any entries past the end of a small matrix left 0. Spill files start with one.
+ */
+typedef struct product_identity {
+    int n;
+    int a_prefix[PREFIX_WORDS];
+    int b_prefix[PREFIX_WORDS];
+} product_identity;
+
+/*
+ * A cached product. Entries are linked into a hash bucket and into the LRU list, whose head is
+ * the most recently used entry. spilled is set once the product has a file in the spill
+ * directory, so that evicting it again does not rewrite the file.
+ */
+typedef struct cache_entry {
+    uint64_t key;
+    product_identity identity;
+    int n;
+    int spilled;
+    int * product;
+    struct cache_entry * bucket_next;
+    struct cache_entry * newer;
+    struct cache_entry * older;
+} cache_entry;
+
+struct product_cache {
+    cache_entry * buckets[BUCKET_COUNT];
+    cache_entry * newest;
+    cache_entry * oldest;
+    long max_bytes;
+    char * spill_directory;
+    product_cache_stats stats;
+};
+
+static uint64_t rotate_left(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read_64(const unsigned char * p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t read_32(const unsigned char * p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t xxh64_round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME64_2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+static uint64_t xxh64_merge_round(uint64_t accumulator, uint64_t value) {
+    accumulator ^= xxh64_round(0, value);
+    return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+/*
+ * Hash a block of memory with XXH64: four independent lanes consume 32 bytes per step, which
+ * keeps the hash close to memory bandwidth.
+ */
+static uint64_t xxh64(const void * data, size_t length, uint64_t seed) {
+    const unsigned char * p = (const unsigned char *) data;
+    const unsigned char * end = p + length;
+    uint64_t h;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        while (p + 32 <= end) {
+            v1 = xxh64_round(v1, read_64(p));
+            v2 = xxh64_round(v2, read_64(p + 8));
+            v3 = xxh64_round(v3, read_64(p + 16));
+            v4 = xxh64_round(v4, read_64(p + 24));
+            p += 32;
+        }
+        h = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) + rotate_left(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+    h += (uint64_t) length;
+
+    while (p + 8 <= end) {
+        h ^= xxh64_round(0, read_64(p));
+        h = rotate_left(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t) read_32(p) * PRIME64_1;
+        h = rotate_left(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotate_left(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * Hash the dimension and contents of both factors. B is seeded with the hash of A so that
+ * swapping the factors gives a different key.
+ */
+uint64_t hash_product(int n, int * A, int * B) {
+    size_t size = (size_t) n * n * sizeof(int);
+    uint64_t a_hash = xxh64(A, size, (uint64_t) n);
+    return xxh64(B, size, a_hash);
+}
+
+/*
+ * Fill in the identity of the product of A and B.
+ */
+static void identify_product(int n, int * A, int * B, product_identity * identity) {
+    int words = (long) n * n < PREFIX_WORDS ? n * n : PREFIX_WORDS;
+    memset(identity, 0, sizeof(product_identity));
+    identity->n = n;
+    memcpy(identity->a_prefix, A, words * sizeof(int));
+    memcpy(identity->b_prefix, B, words * sizeof(int));
+}
+
+/*
+ * Build the path of the spill file for a key. Spill files are named .product rather than .bin
+ * because they are not bare matrices: see product_cache.h for their format.
+ */
+static void spill_path(product_cache * cache, uint64_t key, int n, char * path) {
+    snprintf(path, MAX_PATH_SIZE, "%s/product_%016llx_%i.product", cache->spill_directory,
+             (unsigned long long) key, n);
+}
+
+/*
+ * Write a product to the spill directory as its identity followed by a binary matrix. A product
+ * that could not be written in full is not marked spilled, so a later eviction tries again.
+ */
+static void spill_entry(product_cache * cache, cache_entry * entry) {
+    char path[MAX_PATH_SIZE];
+    spill_path(cache, entry->key, entry->n, path);
+    FILE * fptr = fopen(path, "wb");
+    if (fptr == NULL) {
+        printf("File could not be opened\n");
+        return;
+    }
+    size_t size = (size_t) entry->n * entry->n;
+    int written = fwrite(&entry->identity, sizeof(product_identity), 1, fptr) == 1 &&
+                  fwrite(entry->product, sizeof(int), size, fptr) == size;
+    // fclose flushes what fwrite buffered, so it can fail too.
+    if (fclose(fptr) != 0 || !written) {
+        // Leave no partial file behind for read_spilled to find.
+        printf("Product could not be spilled to %s\n", path);
+        remove(path);
+        return;
+    }
+    entry->spilled = 1;
+    cache->stats.spills++;
+}
+
+/*
+ * Read a spilled product back into C. Returns 1 if it was found with the same identity and 0
+ * otherwise.
+ */
+static int read_spilled(product_cache * cache, uint64_t key, const product_identity * identity,
+                        int * C) {
+    char path[MAX_PATH_SIZE];
+    int n = identity->n;
+    spill_path(cache, key, n, path);
+    FILE * fptr = fopen(path, "rb");
+    if (fptr == NULL) {
+        return 0;
+    }
+    product_identity stored;
+    int found = fread(&stored, sizeof(product_identity), 1, fptr) == 1 &&
+                memcmp(&stored, identity, sizeof(product_identity)) == 0 &&
+                fread(C, sizeof(int), (size_t) n * n, fptr) == (size_t) n * n;
+    fclose(fptr);
+    return found;
+}
+
+static void unlink_lru(product_cache * cache, cache_entry * entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+static void push_newest(product_cache * cache, cache_entry * entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+static void unlink_bucket(product_cache * cache, cache_entry * entry) {
+    cache_entry ** link = &cache->buckets[entry->key % BUCKET_COUNT];
+    while (*link != entry) {
+        link = &(*link)->bucket_next;
+    }
+    *link = entry->bucket_next;
+}
+
+/*
+ * Evict the least recently used entry, spilling it to disk if the cache has a spill directory
+ * and the product is not there already.
+ */
+static void evict_oldest(product_cache * cache) {
+    cache_entry * entry = cache->oldest;
+    if (cache->spill_directory && !entry->spilled) {
+        spill_entry(cache, entry);
+    }
+    unlink_lru(cache, entry);
+    unlink_bucket(cache, entry);
+    cache->stats.bytes -= (long) entry->n * entry->n * sizeof(int);
+    cache->stats.entries--;
+    cache->stats.evictions++;
+    free(entry->product);
+    free(entry);
+}
+
+/*
+ * Find the entry for a product in memory, or return NULL.
+ */
+static cache_entry * find_entry(product_cache * cache, uint64_t key,
+                                const product_identity * identity) {
+    for (cache_entry * entry = cache->buckets[key % BUCKET_COUNT]; entry;
+         entry = entry->bucket_next) {
+        if (entry->key == key &&
+            memcmp(&entry->identity, identity, sizeof(product_identity)) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Copy a product into the cache as its newest entry, evicting old entries to stay within the
+ * byte budget. Products larger than the whole budget are not kept in memory, and neither are
+ * products already there, as when two callers missed on the same product at once. spilled says
+ * whether the product was read back from the spill directory.
+ */
+static void insert_entry(product_cache * cache, uint64_t key, const product_identity * identity,
+                         int * C, int spilled) {
+    int n = identity->n;
+    long bytes = (long) n * n * sizeof(int);
+    if (bytes > cache->max_bytes || find_entry(cache, key, identity)) {
+        return;
+    }
+    while (cache->stats.bytes + bytes > cache->max_bytes) {
+        evict_oldest(cache);
+    }
+
+    cache_entry * entry = (cache_entry *) malloc(sizeof(cache_entry));
+    entry->key = key;
+    entry->identity = *identity;
+    entry->n = n;
+    entry->spilled = spilled;
+    entry->product = (int *) malloc(bytes);
+    memcpy(entry->product, C, bytes);
+    entry->bucket_next = cache->buckets[key % BUCKET_COUNT];
+    cache->buckets[key % BUCKET_COUNT] = entry;
+    push_newest(cache, entry);
+    cache->stats.bytes += bytes;
+    cache->stats.entries++;
+}
+
+/*
+ * Create an empty cache that keeps at most max_bytes of products in memory. If spill_directory
+ * is not NULL, evicted products are written there and found again on later misses.
+ */
+product_cache * product_cache_new(long max_bytes, const char * spill_directory) {
+    product_cache * cache = (product_cache *) calloc(1, sizeof(product_cache));
+    cache->max_bytes = max_bytes;
+    if (spill_directory) {
+        cache->spill_directory = strdup(spill_directory);
+    }
+    return cache;
+}
+
+/*
+ * Write A x B into C if the product is in memory or in the spill directory, and return 1, or
+ * count a miss and return 0. A product found in the spill directory is brought back into memory.
+ */
+int product_cache_lookup(product_cache * cache, int n, int * A, int * B, int * C) {
+    uint64_t key = hash_product(n, A, B);
+    product_identity identity;
+    identify_product(n, A, B, &identity);
+
+    cache_entry * entry = find_entry(cache, key, &identity);
+    if (entry) {
+        memcpy(C, entry->product, (size_t) n * n * sizeof(int));
+        unlink_lru(cache, entry);
+        push_newest(cache, entry);
+        cache->stats.hits++;
+        return 1;
+    }
+    if (cache->spill_directory && read_spilled(cache, key, &identity, C)) {
+        cache->stats.disk_hits++;
+        insert_entry(cache, key, &identity, C, 1);
+        return 1;
+    }
+    cache->stats.misses++;
+    return 0;
+}
+
+/*
+ * Keep C as the product of A and B, after a miss on it was computed.
+ */
+void product_cache_insert(product_cache * cache, int n, int * A, int * B, int * C) {
+    product_identity identity;
+    identify_product(n, A, B, &identity);
+    insert_entry(cache, hash_product(n, A, B), &identity, C, 0);
+}
+
+/*
+ * Write A x B into C, computing it with multiply only if the product is neither in memory nor
+ * in the spill directory.
+ */
+void product_cache_multiply(product_cache * cache, multiply_function multiply, int n, int * A,
+                            int * B, int * C) {
+    if (!product_cache_lookup(cache, n, A, B, C)) {
+        multiply(n, A, B, C);
+        product_cache_insert(cache, n, A, B, C);
+    }
+}
+
+product_cache_stats product_cache_get_stats(product_cache * cache) {
+    return cache->stats;
+}
+
+/*
+ * Print the cache counters.
+ */
+void product_cache_print_stats(product_cache * cache) {
+    product_cache_stats stats = cache->stats;
+    printf("Cache: %li hits, %li disk hits, %li misses, %li evictions, %li spills, "
+           "%i entries using %li bytes\n", stats.hits, stats.disk_hits, stats.misses,
+           stats.evictions, stats.spills, stats.entries, stats.bytes);
+}
+
+/*
+ * Free the cache and every product held in memory. Spilled files are left in place so a later
+ * cache with the same directory can use them.
+ */
+void product_cache_delete(product_cache * cache) {
+    cache_entry * entry = cache->newest;
+    while (entry) {
+        cache_entry * older = entry->older;
+        free(entry->product);
+        free(entry);
+        entry = older;
+    }
+    free(cache->spill_directory);
+    free(cache);
+}
+
+/*
+ * Multiply two matrices A and B with multiply_auto behind a cache shared by the whole process.
+ * The cache is created on first use with a budget of MATRIX_CACHE_BYTES bytes, or
+ * DEFAULT_CACHE_BYTES, and spills to the directory named by MATRIX_CACHE_DIRECTORY if it is set.
+ * One lock guards the cache, and it is let go while a miss is computed, so concurrent callers
+ * only wait on each other for lookups and insertions.
+ */
+void multiply_cached(int n, int * A, int * B, int * C) {
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static product_cache * cache = NULL;
+    pthread_mutex_lock(&lock);
+    if (cache == NULL) {
+        char * bytes = getenv("MATRIX_CACHE_BYTES");
+        cache = product_cache_new(bytes ? atol(bytes) : DEFAULT_CACHE_BYTES,
+                                  getenv("MATRIX_CACHE_DIRECTORY"));
+    }
+    int found = product_cache_lookup(cache, n, A, B, C);
+    pthread_mutex_unlock(&lock);
+    if (found) {
+        return;
+    }
+
+    multiply_auto(n, A, B, C);
+    pthread_mutex_lock(&lock);
+    product_cache_insert(cache, n, A, B, C);
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,45 @@
+/*
+ * Content-addressed cache of square matrix products, keyed by a hash of n, A, and B.
+ * A hit must also match n and the first few entries of A and B, which are stored with every
+ * product. Factors that agree on all of that and still hash alike would be given each other's
+ * product; with a 64-bit hash this is accepted as too unlikely to guard against with a full
+ * comparison, which would need a copy of both factors for every product.
+ * A cache given a spill directory writes each evicted product there once, as
+ * product_<key>_<n>.product with key the hash in hexadecimal. The file holds, as native ints, n,
+ * the first 4 entries of A, and the first 4 entries of B, with entries past the end of a smaller
+ * matrix written as 0, followed by the n x n product in row-major order.
+ * The cache functions are not thread safe; multiply_cached guards its cache with a lock.
+ * Author: Neo Zhou - zhouaea@bc.edu
+ */
+
+#ifndef PRODUCT_CACHE_H
+#define PRODUCT_CACHE_H
+
+#include <stdint.h>
+#include "matrix.h"
+
+typedef struct product_cache_stats {
+    long hits;
+    long disk_hits;
+    long misses;
+    long evictions;
+    long spills;
+    long bytes;
+    int entries;
+} product_cache_stats;
+
+// Define the product_cache struct in product_cache.c so callers can not access it.
+typedef struct product_cache product_cache;
+
+product_cache * product_cache_new(long max_bytes, const char * spill_directory);
+int product_cache_lookup(product_cache * cache, int n, int * A, int * B, int * C);
+void product_cache_insert(product_cache * cache, int n, int * A, int * B, int * C);
+void product_cache_multiply(product_cache * cache, multiply_function multiply, int n, int * A,
+                            int * B, int * C);
+product_cache_stats product_cache_get_stats(product_cache * cache);
+void product_cache_print_stats(product_cache * cache);
+void product_cache_delete(product_cache * cache);
+
+uint64_t hash_product(int n, int * A, int * B);
+
+#endif